@@ -0,0 +1,192 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+	* assembler throughput benchmark
+	*
+	* asmbench gen [-n lines] [-l labels] [-f forward] [-i ids] [-s seed] out.idsm
+	*	writes a reproducible synthetic program, LABELS and IDS are per
+	*	mille of lines, FORWARD is the percentage of jumps to later labels
+	* asmbench run [-a asm] [-j threads] [-O] [lines ...]
+	*	generates programs of the given sizes (1K to 10M lines by default),
+	*	assembles each one and reports lines/sec, MB/sec and peak RSS
+*/
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+typedef struct genprm_t {
+	uint64_t lines;
+	unsigned labels;
+	unsigned forward;
+	unsigned ids;
+	uint64_t seed;
+} genprm_t;
+
+const char *bench_regs[] = {"rg0", "rg1", "rg2", "rg3", "t0", "t1", "t2", "t3", "s0", "s1", "s2", "s3"};
+const char *bench_alu[] = {"mov", "add", "sub", "xor", "and", "or", "cmp"};
+const char *bench_jcc[] = {"jmp", "je", "jne", "jl", "jg", "jle", "jge"};
+
+uint64_t bench_rand(uint64_t *s) {
+	/* xorshift64*, the same seed always gives the same program */
+	*s ^= *s >> 12; *s ^= *s << 25; *s ^= *s >> 27;
+	return *s * UINT64_C(2685821657736338717);
+}
+
+#define PICK(s, a) (a[bench_rand(s) % (sizeof(a)/sizeof(a[0]))])
+
+int bench_literal(FILE *f, uint64_t *s) {
+	/* every literal form idleasm_inttype accepts */
+	unsigned v = (unsigned)(bench_rand(s) & 0xffff);
+	switch(bench_rand(s) % 10) {
+	case 0: return fprintf(f, "%u", v);
+	case 1: return fprintf(f, "%ud", v);
+	case 2: return fprintf(f, "0x%X", v);
+	case 3: return fprintf(f, "0%Xh", v);
+	case 4: return fprintf(f, "0o%o", v);
+	case 5: return fprintf(f, "%oq", v);
+	case 6: return fprintf(f, "0b%s", "1011001");
+	case 7: return fprintf(f, "%sb", "1101");
+	case 8: return fprintf(f, "0d%u", v);
+	default: return fprintf(f, "0%o", v);
+	}
+}
+
+int bench_gen(const genprm_t *g, FILE *f) {
+	/*
+		* label k sits on line k * (1000 / LABELS), so the target of a forward
+		* jump is known before it is written, the program ends in hlt
+	*/
+	uint64_t s = g->seed ? g->seed : 1, nl = g->lines > 1 ? g->lines - 1 : 0;
+	uint64_t step = g->labels ? 1000 / g->labels : 0, nlab = step ? (nl + step - 1) / step : 0, lab = 0;
+	if(step == 0 && g->labels) {step = 1; nlab = nl;}
+	for(uint64_t i = 0; i < nl; i++) {
+		if(step && i % step == 0) {fprintf(f, "L%llu: ", (unsigned long long)lab++);} else {fputs("    ", f);}
+		uint64_t r = bench_rand(&s) % 1000;
+		if(r < g->ids) {
+			fputs("id ", f); bench_literal(f, &s); fputs(";\n", f);
+		} else if(r < g->ids + 150 && nlab) {
+			uint64_t t;
+			if(bench_rand(&s) % 100 < g->forward && lab < nlab) {t = lab + bench_rand(&s) % (nlab - lab);}
+			else if(lab) {t = bench_rand(&s) % lab;}
+			else {t = bench_rand(&s) % nlab;}
+			fprintf(f, "%s L%llu;\n", PICK(&s, bench_jcc), (unsigned long long)t);
+		} else if(r < g->ids + 200) {
+			fprintf(f, "mov %s, 0x%016llX;\n", PICK(&s, bench_regs), (unsigned long long)(bench_rand(&s) | UINT64_C(0x100000000)));
+		} else if(r < g->ids + 500) {
+			fprintf(f, "%s %s, %s;\n", PICK(&s, bench_alu), PICK(&s, bench_regs), PICK(&s, bench_regs));
+		} else {
+			fprintf(f, "%s %s, ", PICK(&s, bench_alu), PICK(&s, bench_regs)); bench_literal(f, &s); fputs(";\n", f);
+		}
+	}
+	fputs("    hlt;\n", f);
+	return 0;
+}
+
+int bench_genmain(int argc, char **argv) {
+	genprm_t g = {1000, 100, 30, 10, 1}; const char *out = NULL;
+	for(int a = 2; a < argc; a++) {
+		if(a + 1 < argc && !strcmp(argv[a], "-n")) {g.lines = strtoull(argv[++a], NULL, 10);}
+		else if(a + 1 < argc && !strcmp(argv[a], "-l")) {g.labels = (unsigned)strtoul(argv[++a], NULL, 10);}
+		else if(a + 1 < argc && !strcmp(argv[a], "-f")) {g.forward = (unsigned)strtoul(argv[++a], NULL, 10);}
+		else if(a + 1 < argc && !strcmp(argv[a], "-i")) {g.ids = (unsigned)strtoul(argv[++a], NULL, 10);}
+		else if(a + 1 < argc && !strcmp(argv[a], "-s")) {g.seed = strtoull(argv[++a], NULL, 10);}
+		else {out = argv[a];}
+	}
+	if(!out || g.labels > 1000 || g.ids > 500 || g.forward > 100) {return 1;}
+	FILE *f = fopen(out, "w");
+	if(!f) {return 1;}
+	bench_gen(&g, f);
+	return fclose(f) != 0;
+}
+
+#if !defined(_WIN32)
+int bench_runmain(int argc, char **argv) {
+	const char *as = "build/asm.exe", *jobs = NULL; int opt = 0, ns = 0;
+	uint64_t sizes[64], def[] = {1000, 10000, 100000, 1000000, 10000000};
+	for(int a = 2; a < argc; a++) {
+		if(a + 1 < argc && !strcmp(argv[a], "-a")) {as = argv[++a];}
+		else if(a + 1 < argc && !strcmp(argv[a], "-j")) {jobs = argv[++a];}
+		else if(!strcmp(argv[a], "-O")) {opt = 1;}
+		else if(ns < 64) {sizes[ns++] = strtoull(argv[a], NULL, 10);}
+	}
+	if(!ns) {memcpy(sizes, def, sizeof(def)); ns = sizeof(def)/sizeof(def[0]);}
+
+	printf("%10s %12s %9s %13s %9s %11s\n", "lines", "bytes", "sec", "lines/sec", "MB/sec", "peak RSS KB");
+	for(int i = 0; i < ns; i++) {
+		genprm_t g = {sizes[i], 100, 30, 10, 1};
+		char src[] = "/tmp/asmbenchXXXXXX", bin[64];
+		int fd = mkstemp(src);
+		FILE *f = fd < 0 ? NULL : fdopen(fd, "w");
+		if(!f) {fprintf(stderr, "asmbench: cannot create %s\n", src); return 1;}
+		bench_gen(&g, f);
+		long sz = ftell(f);
+		fclose(f);
+		snprintf(bin, sizeof(bin), "%s.bin", src);
+
+		struct timespec t0, t1; struct rusage ru; int st;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		pid_t p = fork();
+		if(p == 0) {
+			const char *av[8]; int n = 0;
+			av[n++] = as; av[n++] = src; av[n++] = bin;
+			if(opt) {av[n++] = "-O";}
+			if(jobs) {av[n++] = "-j"; av[n++] = jobs;}
+			av[n] = NULL;
+			execv(as, (char * const *)av);
+			_exit(127);
+		}
+		if(p < 0 || wait4(p, &st, 0, &ru) < 0) {fprintf(stderr, "asmbench: cannot run %s\n", as); return 1;}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		remove(src); remove(bin);
+		if(!WIFEXITED(st) || WEXITSTATUS(st)) {fprintf(stderr, "asmbench: %s failed on %llu lines\n", as, (unsigned long long)sizes[i]); return 1;}
+
+		double sec = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+		printf("%10llu %12ld %9.3f %13.0f %9.1f %11ld\n", (unsigned long long)sizes[i], sz, sec, (double)sizes[i] / sec, (double)sz / sec / 1e6, (long)ru.ru_maxrss);
+		fflush(stdout);
+	}
+	return 0;
+}
+#else
+int bench_runmain(int argc, char **argv) {
+	fprintf(stderr, "asmbench: run needs fork and wait4, use gen and time asm.exe by hand\n");
+	return 1;
+}
+#endif
+
+int main(int argc, char **argv) {
+	if(argc > 1 && !strcmp(argv[1], "gen")) {return bench_genmain(argc, argv);}
+	if(argc > 1 && !strcmp(argv[1], "run")) {return bench_runmain(argc, argv);}
+	fprintf(stderr, "usage: asmbench gen [-n lines] [-l labels] [-f forward] [-i ids] [-s seed] out.idsm\n"
+		"       asmbench run [-a asm] [-j threads] [-O] [lines ...]\n");
+	return 1;
+}
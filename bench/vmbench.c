@@ -0,0 +1,169 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+	* interpreter dispatch benchmark, slots against the compact encoding
+	*
+	* vmbench [-a asm] [-v vm] [-n instructions] [-r runs] [-s seed] [lines ...]
+	*	for each size (1K to 500K lines by default) writes a loop around
+	*	that many straight-line instructions, repeated to run about
+	*	INSTRUCTIONS guest instructions (200M by default), assembles it
+	*	once in slots and once with --compact, runs both and reports size,
+	*	time, guest instructions/sec and L1d misses when the VM can read them,
+	*	each the fastest of RUNS runs (3 by default)
+*/
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+const char *bench_regs[] = {"rg1", "rg2", "rg3", "t0", "t1", "t2", "t3", "s0", "s1", "s2", "s3"};
+const char *bench_rr[] = {"add", "sub", "xor", "and", "or", "mov", "max", "min"};
+const char *bench_ri[] = {"add", "sub", "xor", "or", "shl", "shr", "rol"};
+
+uint64_t bench_rand(uint64_t *s) {
+	/* xorshift64*, the same seed always gives the same program */
+	*s ^= *s >> 12; *s ^= *s << 25; *s ^= *s >> 27;
+	return *s * UINT64_C(2685821657736338717);
+}
+
+#define PICK(s, a) (a[bench_rand(s) % (sizeof(a)/sizeof(a[0]))])
+
+int bench_gen(FILE *f, uint64_t lines, uint64_t iter, uint64_t seed) {
+	/*
+		* half register-register, a third short immediates, the rest wide
+		* enough for the long compact form or a 64-bit literal, the way
+		* compiled code mixes them, s11 counts the iterations
+	*/
+	uint64_t s = seed ? seed : 1;
+	fprintf(f, "    mov s11, %llu;\nL0:\n", (unsigned long long)iter);
+	for(uint64_t i = 0; i < lines; i++) {
+		uint64_t r = bench_rand(&s) % 100;
+		if(r < 50) {
+			fprintf(f, "    %s %s, %s;\n", PICK(&s, bench_rr), PICK(&s, bench_regs), PICK(&s, bench_regs));
+		} else if(r < 85) {
+			fprintf(f, "    %s %s, %u;\n", PICK(&s, bench_ri), PICK(&s, bench_regs), (unsigned)(bench_rand(&s) % 64));
+		} else if(r < 97) {
+			fprintf(f, "    %s %s, %u;\n", bench_rand(&s) & 1 ? "add" : "xor", PICK(&s, bench_regs), (unsigned)(0x1000 + bench_rand(&s) % 0x100000));
+		} else {
+			fprintf(f, "    mov %s, 0x%016llX;\n", PICK(&s, bench_regs), (unsigned long long)(bench_rand(&s) | UINT64_C(0x100000000)));
+		}
+	}
+	fputs("    loop s11, L0;\n    hlt;\n", f);
+	return 0;
+}
+
+#if !defined(_WIN32)
+int bench_exec(const char **av) {
+	/* 0 when the program ran and exited with 0 */
+	int st;
+	fflush(stdout);
+	pid_t p = fork();
+	if(p == 0) {
+		if(!freopen("/dev/null", "w", stdout)) {_exit(127);}
+		execv(av[0], (char * const *)av);
+		_exit(127);
+	}
+	if(p < 0 || waitpid(p, &st, 0) < 0) {return -1;}
+	return !WIFEXITED(st) || WEXITSTATUS(st);
+}
+
+double bench_json(const char *js, const char *key) {
+	/* one number from the vm --perf-counters line, -1 for null or missing */
+	char k[64]; const char *p;
+	snprintf(k, sizeof(k), "\"%s\":", key);
+	p = strstr(js, k);
+	if(!p || !strncmp(p + strlen(k), "null", 4)) {return -1;}
+	return strtod(p + strlen(k), NULL);
+}
+
+int bench_main(int argc, char **argv) {
+	const char *as = "build/asm.exe", *vm = "build/vm.exe"; int ns = 0, runs = 3;
+	uint64_t total = 200000000, seed = 1, sizes[64], def[] = {1000, 10000, 100000, 250000, 500000};
+	for(int a = 1; a < argc; a++) {
+		if(a + 1 < argc && !strcmp(argv[a], "-a")) {as = argv[++a];}
+		else if(a + 1 < argc && !strcmp(argv[a], "-v")) {vm = argv[++a];}
+		else if(a + 1 < argc && !strcmp(argv[a], "-n")) {total = strtoull(argv[++a], NULL, 10);}
+		else if(a + 1 < argc && !strcmp(argv[a], "-r")) {runs = atoi(argv[++a]);}
+		else if(a + 1 < argc && !strcmp(argv[a], "-s")) {seed = strtoull(argv[++a], NULL, 10);}
+		else if(argv[a][0] == '-') {
+			fprintf(stderr, "usage: vmbench [-a asm] [-v vm] [-n instructions] [-r runs] [-s seed] [lines ...]\n");
+			return 1;
+		}
+		else if(ns < 64) {sizes[ns++] = strtoull(argv[a], NULL, 10);}
+	}
+	if(!ns) {memcpy(sizes, def, sizeof(def)); ns = sizeof(def)/sizeof(def[0]);}
+	if(runs < 1) {runs = 1;}
+
+	printf("%8s %-8s %10s %8s %9s %13s %13s\n", "lines", "encoding", "bytes", "sec", "Mguest/s", "l1d misses", "l1d/Mguest");
+	for(int i = 0; i < ns; i++) {
+		char src[] = "/tmp/vmbenchXXXXXX", bin[2][64], js[64];
+		uint64_t iter = sizes[i] ? total / (sizes[i] + 1) : 0;
+		int fd = mkstemp(src);
+		FILE *f = fd < 0 ? NULL : fdopen(fd, "w");
+		if(!f) {fprintf(stderr, "vmbench: cannot create %s\n", src); return 1;}
+		bench_gen(f, sizes[i], iter ? iter : 1, seed);
+		fclose(f);
+		snprintf(js, sizeof(js), "%s.json", src);
+
+		for(int z = 0; z < 2; z++) {
+			const char *aa[] = {as, src, bin[z], z ? "--compact" : NULL, NULL};
+			char pc[96], buf[1024]; struct stat sb;
+			double sec = -1, g = 0, l1d = -1;
+			snprintf(bin[z], sizeof(bin[z]), "%s.%s", src, z ? "z" : "bin");
+			snprintf(pc, sizeof(pc), "--perf-counters=%s", js);
+			const char *va[] = {vm, bin[z], pc, NULL};
+			if(bench_exec(aa) || stat(bin[z], &sb)) {fprintf(stderr, "vmbench: %s failed on %llu lines\n", as, (unsigned long long)sizes[i]); return 1;}
+			for(int r = 0; r < runs; r++) {
+				if(bench_exec(va)) {fprintf(stderr, "vmbench: %s failed on %llu lines\n", vm, (unsigned long long)sizes[i]); return 1;}
+				f = fopen(js, "r");
+				if(!f || !fgets(buf, sizeof(buf), f)) {fprintf(stderr, "vmbench: no counters from %s\n", vm); return 1;}
+				fclose(f);
+				double t = bench_json(buf, "wall_sec");
+				if(sec < 0 || t < sec) {sec = t; g = bench_json(buf, "guest_instructions"); l1d = bench_json(buf, "l1d_misses");}
+			}
+			printf("%8llu %-8s %10lld %8.3f %9.1f", (unsigned long long)sizes[i], z ? "compact" : "slots", (long long)sb.st_size, sec, sec > 0 ? g / sec / 1e6 : 0.0);
+			if(l1d < 0) {printf(" %13s %13s\n", "-", "-");} else {printf(" %13.0f %13.1f\n", l1d, g > 0 ? l1d / g * 1e6 : 0.0);}
+			fflush(stdout);
+			remove(bin[z]);
+		}
+		remove(src); remove(js);
+	}
+	return 0;
+}
+#else
+int bench_main(int argc, char **argv) {
+	fprintf(stderr, "vmbench: needs fork and waitpid, time vm.exe by hand\n");
+	return 1;
+}
+#endif
+
+int main(int argc, char **argv) {
+	return bench_main(argc, argv);
+}
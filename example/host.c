@@ -0,0 +1,46 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+	* embedding example: runs a binary with the host function fib bound,
+	* build with make host, then
+	* asm.exe example/host.idsm host.bin && host.exe host.bin
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/idlevm.h"
+
+int host_fib(idle_vm *v, idlevm_command *cm) {
+	/* rtv = fib(rg0) */
+	uint64_t a = 0, b = 1, t;
+	for(uint64_t n = v->regs[4]; n; n--) {t = a + b; a = b; b = t;}
+	v->regs[2] = a;
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	idle_vm v; size_t n;
+	if(argc < 2) {return 1;}
+	idlevm_init(&v);
+	if(idlevm_bind(&v, "fib", host_fib)) {return 1;}
+	idlevm_command *cm = idlevm_load(&v, argv[1], &n);
+	idlevm_run(&v, cm, n);
+	idlevm_free(&v);
+	free(cm);
+	return 0;
+}
@@ -0,0 +1,458 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "idleop.h"
+#include "idlebin.h"
+
+#define idleaot_error(mac, msg) idleaot_logerr(mac, msg)
+
+#define IDLEAOT_REGS 64
+
+typedef enum idleaot_err {
+	IDLEAOT_ERR_SUCCESSFUL_EXIT = 0,
+	IDLEAOT_ERR_FAILED_EXIT,
+	IDLEAOT_ERR_ALLOCATION_FAILED,
+	IDLEAOT_ERR_FILE_NOT_READ,
+	IDLEAOT_ERR_FILE_NOT_WRITTEN,
+	IDLEAOT_ERR_BAD_BINARY,
+} idleaot_err;
+
+typedef struct opsvd_t {
+	uint16_t op;
+	uint8_t arg0;
+	uint8_t arg1;
+	uint32_t imm;
+} opsvd_t;
+
+/*
+	* C for one instruction, $a and $b are the registers in arg0 and arg1,
+	* $x is arg1 as a number, $i the immediate zero-extended and $s sign-
+	* extended, $w the 64-bit literal, $t the branch target label, $k the
+	* slot of the instruction and $n the slot count; the generated function
+	* keeps guest register k in the local rk
+	* every form does what its case in idlevm_exec does, shift counts are
+	* taken mod 64 and the bit operations mod 32 the way the interpreter
+	* computes them on x86
+*/
+const char *idleaot_tpl[STS + 1] = {
+	[HLT] = "IDLEAOT_SAVE(); return 0;",
+	[NOP] = "",
+	[ADD_R] = "$a += $b;", [ADD_I] = "$a += $i;",
+	[SUB_R] = "$a -= $b;", [SUB_I] = "$a -= $i;",
+	[RSB_R] = "$a = $b - $a;", [RSB_I] = "$a = $i - $a;",
+	[MUL_R] = "$a *= $b;", [MUL_I] = "$a *= $i;",
+	[DIV_R] = "if(!$b) {idle_error(v, IDLEVM_ERR_DIVIDE_BY_ZERO);} $a /= $b;",
+	[DIV_I] = "if(!$i) {idle_error(v, IDLEVM_ERR_DIVIDE_BY_ZERO);} $a /= $i;",
+	[RDV_R] = "if(!$a) {idle_error(v, IDLEVM_ERR_DIVIDE_BY_ZERO);} $a = $b / $a;",
+	[RDV_I] = "if(!$a) {idle_error(v, IDLEVM_ERR_DIVIDE_BY_ZERO);} $a = $i / $a;",
+	[MOD_R] = "if(!$b) {idle_error(v, IDLEVM_ERR_DIVIDE_BY_ZERO);} $a %= $b;",
+	[MOD_I] = "if(!$i) {idle_error(v, IDLEVM_ERR_DIVIDE_BY_ZERO);} $a %= $i;",
+	[RMD_R] = "if(!$a) {idle_error(v, IDLEVM_ERR_DIVIDE_BY_ZERO);} $a = $b % $a;",
+	[RMD_I] = "if(!$a) {idle_error(v, IDLEVM_ERR_DIVIDE_BY_ZERO);} $a = $i % $a;",
+	/* the low 64 bits of a product do not depend on the signs */
+	[IMUL_R] = "$a *= $b;", [IMUL_I] = "$a *= $i;",
+	[IDIV_R] = "if(!$b) {idle_error(v, IDLEVM_ERR_DIVIDE_BY_ZERO);} $a = (uint64_t)((int64_t)$a / (int64_t)$b);",
+	[IDIV_I] = "if(!$i) {idle_error(v, IDLEVM_ERR_DIVIDE_BY_ZERO);} $a = (uint64_t)((int64_t)$a / (int64_t)$i);",
+	[IRDV_R] = "if(!$a) {idle_error(v, IDLEVM_ERR_DIVIDE_BY_ZERO);} $a = (uint64_t)((int64_t)$b / (int64_t)$a);",
+	[IRDV_I] = "if(!$a) {idle_error(v, IDLEVM_ERR_DIVIDE_BY_ZERO);} $a = (uint64_t)((int64_t)$i / (int64_t)$a);",
+	[AND_R] = "$a &= $b;", [AND_I] = "$a &= $i;",
+	[OR_R] = "$a |= $b;", [OR_I] = "$a |= $i;",
+	[XOR_R] = "$a ^= $b;", [XOR_I] = "$a ^= $i;",
+	[NOT_R] = "$a = ~$a;",
+	[SHR_R] = "$a >>= $b & 0x3f;", [SHR_I] = "$a >>= $i & 0x3f;",
+	[SHL_R] = "$a <<= $b & 0x3f;", [SHL_I] = "$a <<= $i & 0x3f;",
+	[ASR_R] = "$a = (uint64_t)((int64_t)$a >> ($b & 0x3f));", [ASR_I] = "$a = (uint64_t)((int64_t)$a >> ($i & 0x3f));",
+	[MOV_R] = "$a = $b;", [MOV_I] = "$a = $i;", [MOV_W] = "$a = $w;",
+	[XCHG] = "t = $a; $a = $b; $b = t;",
+	[CMP_R] = "r0 = CMPFLAGS($a, $b);", [CMP_I] = "r0 = CMPFLAGS($a, (uint64_t)$i);",
+	[JMP] = "goto $t;",
+	[JE] = "if(!(r0 & 0x01)) goto $t;", [JL] = "if(!(r0 & 0x04)) goto $t;", [JG] = "if(!(r0 & 0x02)) goto $t;",
+	[JLE] = "if(!(r0 & 0x05)) goto $t;", [JGE] = "if(!(r0 & 0x03)) goto $t;", [JNE] = "if(!(r0 & 0x06)) goto $t;",
+	[JE_R] = "r0 = CMPFLAGS($a, $b); if(!(r0 & 0x01)) goto $t;", [JE_I] = "r0 = CMPFLAGS($a, (uint64_t)$x); if(!(r0 & 0x01)) goto $t;",
+	[JL_R] = "r0 = CMPFLAGS($a, $b); if(!(r0 & 0x04)) goto $t;", [JL_I] = "r0 = CMPFLAGS($a, (uint64_t)$x); if(!(r0 & 0x04)) goto $t;",
+	[JG_R] = "r0 = CMPFLAGS($a, $b); if(!(r0 & 0x02)) goto $t;", [JG_I] = "r0 = CMPFLAGS($a, (uint64_t)$x); if(!(r0 & 0x02)) goto $t;",
+	[JLE_R] = "r0 = CMPFLAGS($a, $b); if(!(r0 & 0x05)) goto $t;", [JLE_I] = "r0 = CMPFLAGS($a, (uint64_t)$x); if(!(r0 & 0x05)) goto $t;",
+	[JGE_R] = "r0 = CMPFLAGS($a, $b); if(!(r0 & 0x03)) goto $t;", [JGE_I] = "r0 = CMPFLAGS($a, (uint64_t)$x); if(!(r0 & 0x03)) goto $t;",
+	[JNE_R] = "r0 = CMPFLAGS($a, $b); if(!(r0 & 0x06)) goto $t;", [JNE_I] = "r0 = CMPFLAGS($a, (uint64_t)$x); if(!(r0 & 0x06)) goto $t;",
+	[LOOP] = "if(--$a != 0) goto $t;",
+	[INT] = "if($i >= nint) {idle_error(v, IDLEVM_ERR_INCORRECT_INT_NUMBER);} IDLEAOT_SAVE(); v->inint = 1; aint[$i](v, cm); v->inint = 0; IDLEAOT_LOAD();",
+	[PUSH] = "if(r8 >= scap) {idle_error(v, IDLEVM_ERR_STACK_OVERFLOW);} t = $a; astack[r8++] = t;",
+	[POP] = "if(!r8 || r8 > scap) {idle_error(v, IDLEVM_ERR_STACK_UNDERFLOW);} t = astack[--r8]; $a = t;",
+	[BT_R] = "$a = BIT($a, $b);", [BT_I] = "$a = BIT($a, (uint64_t)$i);",
+	[BTS_R] = "$a = BITSET($a, $b);", [BTS_I] = "$a = BITSET($a, (uint64_t)$i);",
+	[BTR_R] = "$a = BITRESET($a, $b);", [BTR_I] = "$a = BITRESET($a, (uint64_t)$i);",
+	[BTI_R] = "$a = BITINVERT($a, $b);", [BTI_I] = "$a = BITINVERT($a, (uint64_t)$i);",
+	[CALL] = "if(r3 >= rcap) {arad = idlevm_growrad(v, r3); rcap = v->radcap;} arad[r3++] = $k; goto $t;",
+	[RET] = "if(!r3) {idle_error(v, IDLEVM_ERR_ADRESS_STACK_UNDERFLOW);} if(r3 > rcap) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} ip = arad[--r3] + 1; goto ret;",
+	[LDB_R] = "t = $b; if(t >= IDLEVM_GUESTLIMIT) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} $a = (uint64_t)araw[t];",
+	[LDB_I] = "t = $i; if(t >= IDLEVM_GUESTLIMIT) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} $a = (uint64_t)araw[t];",
+	[LDDB_R] = "t = $b; if(t >= IDLEVM_GUESTLIMIT / 2) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} $a = (uint64_t)((uint16_t *)araw)[t];",
+	[LDDB_I] = "t = $i; if(t >= IDLEVM_GUESTLIMIT / 2) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} $a = (uint64_t)((uint16_t *)araw)[t];",
+	[LDQB_R] = "t = $b; if(t >= IDLEVM_GUESTLIMIT / 4) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} $a = (uint64_t)((uint32_t *)araw)[t];",
+	[LDQB_I] = "t = $i; if(t >= IDLEVM_GUESTLIMIT / 4) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} $a = (uint64_t)((uint32_t *)araw)[t];",
+	[STB_R] = "t = $b; if(t >= IDLEVM_GUESTLIMIT) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} araw[t] = (uint8_t)$a;",
+	[STB_I] = "t = $i; if(t >= IDLEVM_GUESTLIMIT) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} araw[t] = (uint8_t)$a;",
+	[STDB_R] = "t = $b; if(t >= IDLEVM_GUESTLIMIT / 2) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} ((uint16_t *)araw)[t] = (uint16_t)$a;",
+	[STDB_I] = "t = $i; if(t >= IDLEVM_GUESTLIMIT / 2) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} ((uint16_t *)araw)[t] = (uint16_t)$a;",
+	[STQB_R] = "t = $b; if(t >= IDLEVM_GUESTLIMIT / 4) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} ((uint32_t *)araw)[t] = (uint32_t)$a;",
+	[STQB_I] = "t = $i; if(t >= IDLEVM_GUESTLIMIT / 4) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} ((uint32_t *)araw)[t] = (uint32_t)$a;",
+	[CMOVE_R] = "if(r0 & 0x01) $a = $b;", [CMOVE_I] = "if(r0 & 0x01) $a = $i;",
+	[CMOVL_R] = "if(r0 & 0x04) $a = $b;", [CMOVL_I] = "if(r0 & 0x04) $a = $i;",
+	[CMOVG_R] = "if(r0 & 0x02) $a = $b;", [CMOVG_I] = "if(r0 & 0x02) $a = $i;",
+	[CMOVLE_R] = "if(r0 & 0x05) $a = $b;", [CMOVLE_I] = "if(r0 & 0x05) $a = $i;",
+	[CMOVGE_R] = "if(r0 & 0x03) $a = $b;", [CMOVGE_I] = "if(r0 & 0x03) $a = $i;",
+	[CMOVNE_R] = "if(r0 & 0x06) $a = $b;", [CMOVNE_I] = "if(r0 & 0x06) $a = $i;",
+	[SETE] = "$a = !!(r0 & 0x01);", [SETL] = "$a = !!(r0 & 0x04);", [SETG] = "$a = !!(r0 & 0x02);",
+	[SETLE] = "$a = !!(r0 & 0x05);", [SETGE] = "$a = !!(r0 & 0x03);", [SETNE] = "$a = !!(r0 & 0x06);",
+	[MIN_R] = "t = $a; t1 = $b; $a = t1 < t ? t1 : t;", [MIN_I] = "t = $a; t1 = $i; $a = t1 < t ? t1 : t;",
+	[MAX_R] = "t = $a; t1 = $b; $a = t1 > t ? t1 : t;", [MAX_I] = "t = $a; t1 = $i; $a = t1 > t ? t1 : t;",
+	[IMIN_R] = "t = $a; t1 = $b; $a = (int64_t)t1 < (int64_t)t ? t1 : t;", [IMIN_I] = "t = $a; t1 = $i; $a = (int64_t)t1 < (int64_t)t ? t1 : t;",
+	[IMAX_R] = "t = $a; t1 = $b; $a = (int64_t)t1 > (int64_t)t ? t1 : t;", [IMAX_I] = "t = $a; t1 = $i; $a = (int64_t)t1 > (int64_t)t ? t1 : t;",
+	[POPCNT] = "$a = (uint64_t)__builtin_popcountll($b);",
+	[LZCNT] = "$a = $b ? (uint64_t)__builtin_clzll($b) : 64;",
+	[TZCNT] = "$a = $b ? (uint64_t)__builtin_ctzll($b) : 64;",
+	[BSWAP] = "$a = __builtin_bswap64($a);",
+	[ROL_R] = "$a = ROL($a, $b);", [ROL_I] = "$a = ROL($a, (uint64_t)$i);",
+	[ROR_R] = "$a = ROR($a, $b);", [ROR_I] = "$a = ROR($a, (uint64_t)$i);",
+	[CRC32] = "$a = idlevm_crc32($a, $b);",
+	[UMULH_R] = "$a = (uint64_t)(((idle_u128)$a * $b) >> 64);", [UMULH_W] = "$a = (uint64_t)(((idle_u128)$a * $w) >> 64);",
+	[TCALL] = "goto $t;",
+	[LCALL] = "r9 = $k; goto $t;",
+	[LRET] = "if(r9 >= $n) {idle_error(v, IDLEVM_ERR_INCORRECT_ARGUMENT);} ip = r9 + 1; goto ret;",
+	[ENTER] = "t = r8 + 1 + $i; if(t > scap || t <= r8) {idle_error(v, IDLEVM_ERR_STACK_OVERFLOW);} astack[r8] = r10; r10 = r8 + 1; r8 = t;",
+	[LEAVE] = "if(!r10 || r10 > scap) {idle_error(v, IDLEVM_ERR_STACK_UNDERFLOW);} r8 = r10 - 1; r10 = astack[r8];",
+	[LDS] = "t = $b + $s; if(t >= scap) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} $a = astack[t];",
+	[STS] = "t = $b + $s; if(t >= scap) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);} astack[t] = $a;",
+};
+
+/* written in front of the translated function, the helpers of vm.c it needs */
+const char *idleaot_prologue =
+	"#if !defined(_WIN32)\n"
+	"#define _POSIX_C_SOURCE 200809L\n"
+	"#define _DEFAULT_SOURCE\n"
+	"#endif\n\n"
+	"#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n#include <stdint.h>\n\n"
+	"#if !defined(_WIN32)\n#include <signal.h>\n#endif\n\n"
+	"#include \"idlevm.h\"\n\n"
+	"#define idle_error(v, mac) idleaot_fail(v, mac, #mac)\n\n"
+	"#define BIT(a, i) ((a >> (i & 0x3f)) & 0x1)\n"
+	"#define BITMASK(i) ((uint64_t)(int64_t)(int32_t)(UINT32_C(1) << (i & 0x1f)))\n"
+	"#define BITSET(a, i) (a | BITMASK(i))\n"
+	"#define BITINVERT(a, i) (a ^ BITMASK(i))\n"
+	"#define BITRESET(a, i) (a & ~BITMASK(i))\n"
+	"#define CMPFLAGS(a, b) ((a) > (b) ? 0x2 : ((a) < (b) ? 0x4 : 0x1))\n"
+	"#define ROL(a, i) (((a) << ((i) & 0x3f)) | ((a) >> (-(i) & 0x3f)))\n"
+	"#define ROR(a, i) (((a) >> ((i) & 0x3f)) | ((a) << (-(i) & 0x3f)))\n\n"
+	"__extension__ typedef unsigned __int128 idle_u128;\n\n"
+	"static __attribute__((noreturn, cold)) void idleaot_fail(idle_vm *v, int e, const char *msg) {\n"
+	"\tidlevm_logerr(v, e, msg);\n"
+	"\texit(e);\n"
+	"}\n\n";
+
+/* the stand-alone program, takes the -m/-M options of vm.exe */
+const char *idleaot_epilogue =
+	"#ifndef IDLEAOT_EMBED\n"
+	"int main(int argc, char **argv) {\n"
+	"\tidle_vm v;\n"
+	"\tidlevm_init(&v);\n"
+	"\tfor(int a = 1; a < argc; a++) {\n"
+	"\t\tint fl = !strcmp(argv[a], \"-M\") ? IDLEVM_MAP_COW : IDLEVM_MAP_RDONLY;\n"
+	"\t\tif(a + 1 >= argc || (strcmp(argv[a], \"-m\") && strcmp(argv[a], \"-M\"))) {idle_error(&v, IDLEVM_ERR_INCORRECT_ARGUMENT);}\n"
+	"\t\tif(idlevm_mapfile(&v, argv[++a], fl) == IDLEVM_MAP_FAILED) {idle_error(&v, IDLEVM_ERR_FILE_NOT_READ);}\n"
+	"\t}\n"
+	"#if !defined(_WIN32)\n"
+	"\tstruct sigaction sa;\n"
+	"\tmemset(&sa, 0, sizeof(sa));\n"
+	"\tsa.sa_handler = idlevm_fault;\n"
+	"\tsigaction(SIGSEGV, &sa, NULL);\n"
+	"\tsigaction(SIGBUS, &sa, NULL);\n"
+	"#endif\n"
+	"\tidleaot_run(&v);\n"
+	"\tidlevm_free(&v);\n"
+	"\treturn 0;\n"
+	"}\n"
+	"#endif\n";
+
+typedef struct aotprog_t {
+	/*
+		* RAW = the binary as read, NRAW slots of it, the generated code
+		* links these for its imports and loadid
+		* N = instructions, SVD = each decoded, LIT = its 64-bit literal
+		* (the next slot, or the pool entry of a compact word)
+		* DATA = the slot is the literal of the instruction before it,
+		* TGT = some branch lands on it, RETT = ret or lret can land on it
+	*/
+	uint64_t *raw;
+	uint64_t nraw;
+	uint64_t n;
+	int compact;
+	opsvd_t *svd;
+	uint64_t *lit;
+	uint8_t *data;
+	uint8_t *tgt;
+	uint8_t *rett;
+} aotprog_t;
+
+void idleaot_logerr(int e, const char *msg) {
+	fprintf(stderr, "[idleaot_err] %#.8x, %s\n", e, msg);
+	exit(e);
+}
+
+void *idleaot_alloc(size_t n) {
+	void *p = calloc(1, n ? n : 1);
+	if(!p) {idleaot_error(IDLEAOT_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+	return p;
+}
+
+int idleaot_load(aotprog_t *p, const char *path) {
+	/* reads a binary the way idlevm_load and idlevm_link take it */
+	FILE *f = fopen(path, "rb");
+	uint64_t ns, np = 0; idlebin_ftr ft; int z = 0, hasf = 0;
+	if(!f) {idleaot_error(IDLEAOT_ERR_FILE_NOT_READ, "failed to read file");}
+	fseek(f, 0, SEEK_END);
+	long sz = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	p->nraw = sz > 0 ? (uint64_t)sz / sizeof(uint64_t) : 0;
+	if(!p->nraw) {idleaot_error(IDLEAOT_ERR_FILE_NOT_READ, "binary is empty");}
+	p->raw = idleaot_alloc(p->nraw * sizeof(uint64_t));
+	if(fread(p->raw, sizeof(uint64_t), p->nraw, f) != p->nraw) {idleaot_error(IDLEAOT_ERR_FILE_NOT_READ, "failed to read file");}
+	fclose(f);
+
+	p->n = p->nraw;
+	if(p->nraw >= 2) {
+		memcpy(&ft, &p->raw[p->nraw - 2], sizeof(ft));
+		z = !memcmp(ft.magic, IDLEBIN_ZMAGIC, 4);
+		ns = z ? ((uint64_t)ft.nslot + 1) / 2 : ft.nslot;
+		hasf = (z || !memcmp(ft.magic, IDLEBIN_MAGIC, 4)) && !(ft.strsz % sizeof(uint64_t)) && ns + ft.strsz / sizeof(uint64_t) + 2 <= p->nraw;
+		if(hasf) {np = p->nraw - 2 - ns - ft.strsz / sizeof(uint64_t);}
+		if(hasf && (z ? !np : np)) {hasf = 0;}
+		if(hasf) {p->n = ft.nslot;}
+		else {z = 0;}
+	}
+	p->compact = z;
+	p->svd = idleaot_alloc(p->n * sizeof(opsvd_t));
+	p->lit = idleaot_alloc(p->n * sizeof(uint64_t));
+	p->data = idleaot_alloc(p->n);
+	p->tgt = idleaot_alloc(p->n + 1);
+	p->rett = idleaot_alloc(p->n + 1);
+
+	if(z) {
+		const uint32_t *cz = (const uint32_t *)p->raw; const uint64_t *zp = p->raw + (p->n + 1) / 2;
+		for(uint64_t i = 0; i < p->n; i++) {
+			uint32_t w = cz[i];
+			p->svd[i].op = (uint16_t)(w & 0xff);
+			p->svd[i].arg0 = (uint8_t)(w >> 9 & 0x3f);
+			if(w & IDLEBIN_ZLONG) {
+				if((w >> 15) >= np) {idleaot_error(IDLEAOT_ERR_BAD_BINARY, "pool index past the pool");}
+				p->lit[i] = zp[w >> 15];
+				p->svd[i].arg1 = (uint8_t)(p->lit[i] >> 32);
+				p->svd[i].imm = (uint32_t)p->lit[i];
+			} else {
+				/* the interpreter would read a stale pool entry, asm never writes these */
+				if(p->svd[i].op == MOV_W || p->svd[i].op == UMULH_W) {idleaot_error(IDLEAOT_ERR_BAD_BINARY, "wide literal in a short word");}
+				p->svd[i].arg1 = (uint8_t)(w >> 15 & 0x3f);
+				p->svd[i].imm = (uint32_t)((int32_t)w >> 21);
+			}
+		}
+		return 0;
+	}
+	for(uint64_t i = 0; i < p->n; i++) {
+		memcpy(&p->svd[i], &p->raw[i], sizeof(opsvd_t));
+		p->lit[i] = i + 1 < p->n ? p->raw[i + 1] : 0;
+	}
+	/* a literal slot is only run when something jumps to it */
+	for(uint64_t i = 0; i < p->n; i++) {
+		if((p->svd[i].op == MOV_W || p->svd[i].op == UMULH_W) && i + 1 < p->n) {p->data[++i] = 1;}
+	}
+	return 0;
+}
+
+int idleaot_branch(uint16_t op) {
+	return (op >= JMP && op <= JNE) || (op >= JE_R && op <= LOOP) || op == CALL || op == TCALL || op == LCALL;
+}
+
+int64_t idleaot_target(aotprog_t *p, uint64_t i) {
+	/* the slot a taken branch runs next, -1 when that ends the run */
+	int64_t t = (int64_t)i + (int64_t)(int32_t)p->svd[i].imm + 1;
+	return t < 0 || (uint64_t)t >= p->n ? -1 : t;
+}
+
+int idleaot_wide(aotprog_t *p, uint64_t i) {
+	/* mov/umulh wide with its literal in the next slot */
+	return !p->compact && (p->svd[i].op == MOV_W || p->svd[i].op == UMULH_W);
+}
+
+int idleaot_mark(aotprog_t *p) {
+	/*
+		* branch targets and return points; ret can only land after a call
+		* or at slot 1 from a return stack entry no call wrote, lret after an
+		* lcall unless the program writes rtaa itself, then anywhere
+	*/
+	int anyret = 0, rtaa = 0;
+	for(uint64_t i = 0; i < p->n; i++) {
+		opsvd_t c = p->svd[i]; int64_t t;
+		if(idleaot_branch(c.op) && (t = idleaot_target(p, i)) >= 0) {p->tgt[t] = 1;}
+		if(c.op == CALL || c.op == LCALL) {p->rett[i + 1] = 1;}
+		if(c.op == RET || c.op == LRET) {anyret = 1;}
+		if(!p->data[i] && c.op != LCALL && (c.arg0 == 9 || (c.op == XCHG && c.arg1 == 9) || (c.op == POPM && c.arg0 <= 9 && c.arg1 >= 9))) {rtaa = 1;}
+	}
+	if(anyret && p->n > 1) {p->rett[1] = 1;}
+	for(uint64_t i = 0; anyret && rtaa && i < p->n; i++) {p->rett[i] = 1;}
+	for(uint64_t i = 0; i < p->n; i++) {
+		if(p->rett[i]) {p->tgt[i] = 1;}
+	}
+	/* a wide instruction whose literal slot is also run jumps over it */
+	for(uint64_t i = 0; i + 2 <= p->n; i++) {
+		if(idleaot_wide(p, i) && p->tgt[i + 1]) {p->tgt[i + 2] = 1;}
+	}
+	return anyret;
+}
+
+int idleaot_reg(FILE *f, uint8_t r) {
+	return fprintf(f, "r%u", (unsigned)r);
+}
+
+int idleaot_label(FILE *f, aotprog_t *p, int64_t t) {
+	return t < 0 || (uint64_t)t >= p->n ? fprintf(f, "end") : fprintf(f, "L%lld", (long long)t);
+}
+
+int idleaot_inst(FILE *f, aotprog_t *p, uint64_t i, uint8_t *used) {
+	/* the statement of instruction I, registers it names are marked in USED */
+	opsvd_t c = p->svd[i];
+	const char *s = c.op <= STS ? idleaot_tpl[c.op] : NULL;
+	if(!s) {return fprintf(f, "idle_error(v, IDLEVM_ERR_INCORRECT_OPCODE);");}
+	if((strstr(s, "$a") && c.arg0 >= IDLEAOT_REGS) || (strstr(s, "$b") && c.arg1 >= IDLEAOT_REGS)) {
+		return fprintf(f, "idle_error(v, IDLEVM_ERR_INCORRECT_ARGUMENT);");
+	}
+	if(idleaot_wide(p, i) && i + 1 >= p->n) {return fprintf(f, "idle_error(v, IDLEVM_ERR_INCORRECT_ARGUMENT);");}
+	for(; *s; s++) {
+		if(*s != '$') {fputc(*s, f); continue;}
+		switch(*++s) {
+		case 'a': idleaot_reg(f, c.arg0); used[c.arg0] = 1; break;
+		case 'b': idleaot_reg(f, c.arg1); used[c.arg1] = 1; break;
+		case 'x': fprintf(f, "%u", (unsigned)c.arg1); break;
+		case 'i': fprintf(f, "0x%xu", (unsigned)c.imm); break;
+		case 's': fprintf(f, "(uint64_t)(int64_t)%d", (int)(int32_t)c.imm); break;
+		case 'w': fprintf(f, "UINT64_C(0x%llx)", (unsigned long long)p->lit[i]); break;
+		case 't': idleaot_label(f, p, idleaot_target(p, i)); break;
+		case 'k': fprintf(f, "%llu", (unsigned long long)i); break;
+		case 'n': fprintf(f, "%llu", (unsigned long long)p->n); break;
+		}
+	}
+	return 0;
+}
+
+int idleaot_block(FILE *f, aotprog_t *p, uint64_t i, uint8_t *used) {
+	/* pushm/popm of a fixed register range, one store or load each */
+	opsvd_t c = p->svd[i]; unsigned a = c.arg0, b = c.arg1, t = b - a + 1;
+	if(b < a || b >= IDLEAOT_REGS) {return fprintf(f, "idle_error(v, IDLEVM_ERR_INCORRECT_ARGUMENT);");}
+	if(c.op == PUSHM) {
+		fprintf(f, "if(r8 > scap - %u) {idle_error(v, IDLEVM_ERR_STACK_OVERFLOW);}", t);
+		for(unsigned k = a; k <= b; k++) {fprintf(f, " astack[r8 + %u] = r%u;", k - a, k); used[k] = 1;}
+		return fprintf(f, " r8 += %u;", t);
+	}
+	fprintf(f, "if(r8 < %u || r8 > scap) {idle_error(v, IDLEVM_ERR_STACK_UNDERFLOW);} r8 -= %u; t = r8;", t, t);
+	for(unsigned k = a; k <= b; k++) {fprintf(f, " r%u = astack[t + %u];", k, k - a); used[k] = 1;}
+	return 0;
+}
+
+int idleaot_emit(FILE *f, aotprog_t *p, const char *src) {
+	/*
+		* the body goes to a temporary file first, the register locals and
+		* the save/load macros in front of it depend on what it used
+	*/
+	uint8_t used[IDLEAOT_REGS] = {0}; int anyret = idleaot_mark(p); int ch;
+	FILE *b = tmpfile();
+	if(!b) {idleaot_error(IDLEAOT_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	used[0] = used[3] = used[8] = used[9] = used[10] = 1;
+	for(uint64_t i = 0; i < p->n; i++) {
+		if(p->data[i] && !p->tgt[i]) {continue;}
+		if(p->tgt[i]) {fprintf(b, "L%llu:\n", (unsigned long long)i);}
+		fputc('\t', b);
+		if(p->svd[i].op == PUSHM || p->svd[i].op == POPM) {idleaot_block(b, p, i, used);}
+		else {idleaot_inst(b, p, i, used);}
+		if(idleaot_wide(p, i) && i + 2 <= p->n && p->tgt[i + 1]) {fputs(" goto ", b); idleaot_label(b, p, (int64_t)i + 2); fputc(';', b);}
+		fputc('\n', b);
+	}
+	fputs("end:\n\tIDLEAOT_SAVE();\n\treturn 0;\n", b);
+	if(anyret) {
+		fputs("ret:\n\tswitch(ip) {\n", b);
+		for(uint64_t i = 0; i < p->n; i++) {
+			if(p->rett[i]) {fprintf(b, "\tcase %llu: goto L%llu;\n", (unsigned long long)i, (unsigned long long)i);}
+		}
+		/* only a return address a host function wrote gets here */
+		fprintf(b, "\tdefault: if(ip >= %llu) {goto end;} idle_error(v, IDLEVM_ERR_INCORRECT_ARGUMENT);\n\t}\n", (unsigned long long)p->n);
+	}
+
+	fprintf(f, "/* translated from %s by aot.exe */\n\n", src);
+	fputs(idleaot_prologue, f);
+	fputs("#define IDLEAOT_SAVE() do {", f);
+	for(unsigned k = 0; k < IDLEAOT_REGS; k++) {if(used[k]) {fprintf(f, " v->regs[%u] = r%u;", k, k);}}
+	fputs(" } while(0)\n#define IDLEAOT_LOAD() do {", f);
+	for(unsigned k = 0; k < IDLEAOT_REGS; k++) {if(used[k]) {fprintf(f, " r%u = v->regs[%u];", k, k);}}
+	fputs(" } while(0)\n\n", f);
+
+	fprintf(f, "static uint64_t idleaot_code[%llu] = {", (unsigned long long)p->nraw);
+	for(uint64_t i = 0; i < p->nraw; i++) {fprintf(f, "%sUINT64_C(0x%llx),", i % 4 ? " " : "\n\t", (unsigned long long)p->raw[i]);}
+	fputs("\n};\n\n", f);
+
+	fputs("int idleaot_run(idle_vm *v) {\n", f);
+	fputs("\t/* links the code above against V and runs it from slot 0 like idlevm_run, v->icount is not kept */\n", f);
+	fputs("\tidlevm_command *cm = (idlevm_command *)idleaot_code;\n", f);
+	fprintf(f, "\tidlevm_link(v, cm, %llu);\n", (unsigned long long)p->nraw);
+	fputs("\tuint64_t t, t1, ip;\n", f);
+	fputs("\tuint64_t *astack = v->stack, *arad = v->radress, rcap = v->radcap;\n", f);
+	fputs("\tuint64_t scap = (v->mp - 1) * IDLE_DEFAULTSTACK;\n", f);
+	fputs("\tuint8_t *araw = v->raw_data;\n", f);
+	fputs("\tidlevm_func *aint = v->ints; uint64_t nint = v->nint;\n", f);
+	for(unsigned k = 0; k < IDLEAOT_REGS; k++) {if(used[k]) {fprintf(f, "\tuint64_t r%u = v->regs[%u];\n", k, k);}}
+	fputs("\t(void)t; (void)t1; (void)ip; (void)astack; (void)arad; (void)rcap; (void)scap; (void)araw; (void)aint; (void)nint;\n", f);
+	rewind(b);
+	while((ch = fgetc(b)) != EOF) {fputc(ch, f);}
+	fclose(b);
+	fputs("}\n\n", f);
+	fputs(idleaot_epilogue, f);
+	return 0;
+}
+
+int idleaot_main(int argc, char **argv) {
+	/*
+		* aot.exe program.bin program.c
+		* translates a binary, slots or compact, to C that builds with
+		* src/vm.c -DIDLEVM_EMBED into a program that runs it like vm.exe,
+		* with -DIDLEAOT_EMBED it leaves out main and a host calls idleaot_run
+	*/
+	aotprog_t p; memset(&p, 0, sizeof(p));
+	if(argc != 3) {
+		fprintf(stderr, "usage: aot program.bin program.c\n");
+		return IDLEAOT_ERR_FAILED_EXIT;
+	}
+	idleaot_load(&p, argv[1]);
+	FILE *f = fopen(argv[2], "w");
+	if(!f) {idleaot_error(IDLEAOT_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	idleaot_emit(f, &p, argv[1]);
+	if(fclose(f)) {idleaot_error(IDLEAOT_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	return idleaot_main(argc, argv);
+}
@@ -14,22 +14,49 @@ Copyright 2025 nightmilkyway
    limitations under the License.
 */
 
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <strings.h>
 #include <stdint.h>
+#include <stddef.h>
+
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <pthread.h>
+
+#include "idleop.h"
+#include "idleobj.h"
+#include "idlebin.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define IDLE_X86 1
+#endif
 
 #define ISOCTAL(c) ((c) >= '0' && (c) <= '7')
 #define ISBINARY(c) ((c) >= '0' && (c) <= '1')
 #define arraysize(a) (sizeof(a)/sizeof(a[0]))
 
 #define IDLEASM_TOKENCOUNT 16
-#define IDLEASM_TOKENSIZE 32
 #define IDLEASM_TABLESIZE 256
 #define IDLEASM_SVDCOUNT 4096
 #define IDLEASM_LABELCOUNT 4096
-#define IDLEASM_STCOUNT 1048576
+#define IDLEASM_PHASHSIZE 2048
+#define IDLEASM_ARENABLOCK 1048576
+#define IDLEASM_CHUNKMIN 65536
+#define IDLEASM_VERSION 1
 
 //#define IDLEASM_BIGENDIAN 0
 //#define IDLEASM_LITTLEENDIAN 1
@@ -41,6 +68,21 @@ Copyright 2025 nightmilkyway
 #define IDLEASM_TYPE_IMM 2
 #define IDLEASM_TYPE_FLOAT 3
 #define IDLEASM_TYPE_IDENT 4
+#define IDLEASM_TYPE_WIMM 5
+
+#define IDLEASM_SLOT_DATA 0x01
+#define IDLEASM_SLOT_LABEL 0x02
+#define IDLEASM_SLOT_DEL 0x04
+#define IDLEASM_SLOT_MAGIC 0x08
+
+#define IDLEASM_FIX_REL 0
+#define IDLEASM_FIX_IMM 1
+#define IDLEASM_FIX_DATA 2
+
+#define IDLEASM_MACRODEPTH 64
+
+#define IDLEASM_NAME_CONST 1
+#define IDLEASM_NAME_MACRO 2
 
 typedef enum idleasm_err {
 	IDLEASM_ERR_SUCCESSFUL_EXIT = 0,
@@ -52,9 +94,32 @@ typedef enum idleasm_err {
 	IDLEASM_ERR_INTEGER_CONST_ISNT_VALID,
 	IDLEASM_ERR_ALLOCATION_FAILED,
 	IDLEASM_ERR_FILE_NOT_READ,
+	IDLEASM_ERR_FILE_NOT_WRITTEN,
+	IDLEASM_ERR_SERIAL_ONLY,
 } idleasm_err;
 
+typedef struct srcpos_t {
+	const char *file;
+	unsigned line;
+	unsigned col;
+} srcpos_t;
+
+typedef struct idlechunk_t idlechunk_t;
+
+__thread srcpos_t idleasm_pos;
+__thread idlechunk_t *idleasm_chunk;
+const char *idleasm_out;
+
+void idleasm_chunkerr(int e, const char *msg);
+
 void idleasm_logerr(int e, const char *msg) {
+	if(idleasm_chunk) {idleasm_chunkerr(e, msg);}
+	/* a failed run leaves no output, what was streamed so far could still run */
+	if(idleasm_out) {remove(idleasm_out);}
+	if(idleasm_pos.line) {
+		fprintf(stderr, "[idleasm_err] %#.8x, %s:%u:%u: %s\n", e, idleasm_pos.file, idleasm_pos.line, idleasm_pos.col, msg);
+		exit(e);
+	}
 	fprintf(stderr, "[idleasm_err] %#.8x, %s\n", e, msg);
 	exit(e);
 }
@@ -92,6 +157,7 @@ typedef enum parser_token {
 	IDLEASM_PARSER_SEMICOLON,
 	IDLEASM_PARSER_COLON,
 	IDLEASM_PARSER_IDENT,
+	IDLEASM_PARSER_EXPR,
 } parser_token;
 
 typedef struct opboard_t {
@@ -101,16 +167,69 @@ typedef struct opboard_t {
 	parser_token t;
 } opboard_t;
 
+typedef struct arenablk_t {
+	/* PAD makes the header 4 words, so DATA keeps the 16-byte alignment of calloc */
+	struct arenablk_t *next;
+	size_t size;
+	size_t used;
+	size_t pad;
+	unsigned char data[];
+} arenablk_t;
+
+typedef struct idlearena_t {
+	arenablk_t *blk;
+} idlearena_t;
+
+typedef struct macro_t {
+	/*
+		* body = lines [B, E) of SRC, PAR = NP parameter names
+		* POS = the macro line, for a missing endm
+	*/
+	const char *src;
+	size_t b;
+	size_t e;
+	unsigned np;
+	const char **par;
+	unsigned *pl;
+	srcpos_t pos;
+	struct labelstat_t *lb;
+	struct macro_t *next;
+} macro_t;
+
 typedef struct labelstat_t {
-	char *lb_name;
+	/*
+		* CST = IDLEASM_NAME_CONST: an equ constant with its value in LN,
+		* IDLEASM_NAME_MACRO: a macro of the prm->mac list
+	*/
+	const char *lb_name;
+	unsigned len;
+	uint32_t cst;
 	uint64_t ln;
+	uint32_t hash;
+	uint32_t def;
+	uint32_t glb;
+	uint32_t idx;
+	struct labelstat_t *next;
 } labelstat_t;
 
+typedef struct fixstat_t {
+	/*
+		* REL = branch to LB, IMM and DATA = expression that names a later
+		* label, folded into the imm or the whole data slot, its LB is not
+		* interned and only spans the expression text
+	*/
+	labelstat_t *lb;
+	uint32_t slot;
+	uint32_t kind;
+	srcpos_t pos;
+} fixstat_t;
+
 typedef struct argtype_t {
 	char *name;
 	uint16_t op;
 	uint8_t at0;
 	uint8_t at1;
+	uint8_t at2;
 } argtype_t;
 
 typedef struct nstat_t {
@@ -126,15 +245,39 @@ typedef struct opsvd_t {
 } opsvd_t;
 
 typedef struct idleprm_t {
+	idlearena_t ar;
 	opsvd_t *svd;
+	uint8_t *flg;
+	labelstat_t **lht;
 	labelstat_t *lbl;
+	labelstat_t *lbt;
+	fixstat_t *fix;
+	uint32_t *lin;
+	FILE *out;
 	unsigned isvd;
 	unsigned iptr;
 	unsigned mlp;
+	unsigned hcap;
+	unsigned ifix;
+	unsigned fcap;
+	unsigned ncap;
+	unsigned defer;
+	unsigned absref;
+	unsigned depth;
+	unsigned ncst;
+	const char *table;
+	macro_t *mdef;
+	macro_t *mac;
+	labelstat_t *imp;
+	unsigned nimp;
+	uint32_t *zw;
+	uint64_t *zp;
+	unsigned nzp;
+	unsigned zip;
 } idleprm_t;
 
 const char *intr_name[65536] = {
-	"exit\0", "abort\0", "readc\0", "writec\0", "loadsd\0", "loadad\0", "loadid\0", "writes\0", "reads\0", "writen\0", "readn\0", NULL
+	"exit\0", "abort\0", "readc\0", "writec\0", "loadsd\0", "loadad\0", "loadid\0", "writes\0", "reads\0", "writen\0", "readn\0", "mapf\0", "mapinfo\0", NULL
 };
 
 const opboard_t opbrd[] = {
@@ -191,20 +334,41 @@ const argtype_t mn[] = {
 	{"shl", 34, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
 	{"mov", 35, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
 	{"mov", 36, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"mov", 74, IDLEASM_TYPE_REG, IDLEASM_TYPE_WIMM},
 	{"xchg", 37, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
 	{"cmp", 38, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
 	{"cmp", 39, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
 	{"jmp", 40, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
 	{"je", 41, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
+	{"je", 75, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG, IDLEASM_TYPE_IDENT},
+	{"je", 76, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM, IDLEASM_TYPE_IDENT},
 	{"jl", 42, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
+	{"jl", 77, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG, IDLEASM_TYPE_IDENT},
+	{"jl", 78, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM, IDLEASM_TYPE_IDENT},
 	{"jnge", 42, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
+	{"jnge", 77, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG, IDLEASM_TYPE_IDENT},
+	{"jnge", 78, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM, IDLEASM_TYPE_IDENT},
 	{"jg", 43, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
+	{"jg", 79, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG, IDLEASM_TYPE_IDENT},
+	{"jg", 80, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM, IDLEASM_TYPE_IDENT},
 	{"jnle", 43, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
+	{"jnle", 79, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG, IDLEASM_TYPE_IDENT},
+	{"jnle", 80, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM, IDLEASM_TYPE_IDENT},
 	{"jle", 44, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
+	{"jle", 81, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG, IDLEASM_TYPE_IDENT},
+	{"jle", 82, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM, IDLEASM_TYPE_IDENT},
 	{"jng", 44, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
+	{"jng", 81, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG, IDLEASM_TYPE_IDENT},
+	{"jng", 82, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM, IDLEASM_TYPE_IDENT},
 	{"jge", 45, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
+	{"jge", 83, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG, IDLEASM_TYPE_IDENT},
+	{"jge", 84, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM, IDLEASM_TYPE_IDENT},
 	{"jnl", 45, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
+	{"jnl", 83, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG, IDLEASM_TYPE_IDENT},
+	{"jnl", 84, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM, IDLEASM_TYPE_IDENT},
 	{"jne", 46, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
+	{"jne", 85, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG, IDLEASM_TYPE_IDENT},
+	{"jne", 86, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM, IDLEASM_TYPE_IDENT},
 	{"int", 47, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
 	{"push", 48, IDLEASM_TYPE_REG, IDLEASM_TYPE_NULL},
 	{"pop", 49, IDLEASM_TYPE_REG, IDLEASM_TYPE_NULL},
@@ -232,7 +396,55 @@ const argtype_t mn[] = {
 	{"stdb", 71, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
 	{"stqb", 72, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
 	{"stqb", 73, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"loop", 87, IDLEASM_TYPE_REG, IDLEASM_TYPE_IDENT},
+	{"cmove", 88, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"cmove", 89, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"cmovl", 90, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"cmovl", 91, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"cmovg", 92, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"cmovg", 93, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"cmovle", 94, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"cmovle", 95, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"cmovge", 96, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"cmovge", 97, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"cmovne", 98, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"cmovne", 99, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"sete", 100, IDLEASM_TYPE_REG, IDLEASM_TYPE_NULL},
+	{"setl", 101, IDLEASM_TYPE_REG, IDLEASM_TYPE_NULL},
+	{"setg", 102, IDLEASM_TYPE_REG, IDLEASM_TYPE_NULL},
+	{"setle", 103, IDLEASM_TYPE_REG, IDLEASM_TYPE_NULL},
+	{"setge", 104, IDLEASM_TYPE_REG, IDLEASM_TYPE_NULL},
+	{"setne", 105, IDLEASM_TYPE_REG, IDLEASM_TYPE_NULL},
+	{"min", 106, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"min", 107, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"max", 108, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"max", 109, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"imin", 110, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"imin", 111, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"imax", 112, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"imax", 113, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"popcnt", 114, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"lzcnt", 115, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"tzcnt", 116, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"bswap", 117, IDLEASM_TYPE_REG, IDLEASM_TYPE_NULL},
+	{"rol", 118, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"rol", 119, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"ror", 120, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"ror", 121, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"crc32", 122, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"umulh", 123, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"umulh", 124, IDLEASM_TYPE_REG, IDLEASM_TYPE_WIMM},
+	{"tcall", 125, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
+	{"lcall", 126, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
+	{"lret", 127, IDLEASM_TYPE_NULL, IDLEASM_TYPE_NULL},
+	{"enter", 128, IDLEASM_TYPE_IMM, IDLEASM_TYPE_NULL},
+	{"leave", 129, IDLEASM_TYPE_NULL, IDLEASM_TYPE_NULL},
+	{"pushm", 130, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"popm", 131, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG},
+	{"lds", 132, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
+	{"sts", 133, IDLEASM_TYPE_REG, IDLEASM_TYPE_REG, IDLEASM_TYPE_IMM},
 	{"id", 0xf001, IDLEASM_TYPE_IMM, IDLEASM_TYPE_NULL},
+	{"global", 0xf002, IDLEASM_TYPE_IDENT, IDLEASM_TYPE_NULL},
 };
 
 const nstat_t r[] = {
@@ -271,12 +483,69 @@ const nstat_t r[] = {
 	{"y60", 0x3c}, {"y61", 0x3d}, {"y62", 0x3e}, {"y63", 0x3f}
 };
 
+/*
+	* perfect hashes of the mnemonic and register names, the seed is searched
+	* once at startup so that every distinct name gets its own slot and a
+	* lookup is one hash, one probe and one compare
+*/
+int16_t mnhash[IDLEASM_PHASHSIZE], rhash[IDLEASM_PHASHSIZE];
+uint32_t mnseed, rseed;
+
+uint32_t idleasm_hash(const char *s, size_t n, uint32_t seed) {
+	uint32_t h = UINT32_C(2166136261) ^ seed;
+	for(size_t i = 0; i < n; i++) {h = (h ^ (uint8_t)tolower((unsigned char)s[i])) * UINT32_C(16777619);}
+	h ^= h >> 15; h *= UINT32_C(0x2c1b3c6d); h ^= h >> 12;
+	return h;
+}
+
+int idleasm_phash_build(int16_t *tb, uint32_t *seed, const void *base, size_t stride, unsigned n) {
+	for(*seed = 0; *seed < UINT32_C(0x100000); (*seed)++) {
+		unsigned x;
+		memset(tb, 0xff, IDLEASM_PHASHSIZE * sizeof(int16_t));
+		for(x = 0; x < n; x++) {
+			const char *nm = *(char * const *)((const char *)base + x*stride);
+			uint32_t h = idleasm_hash(nm, strlen(nm), *seed) & (IDLEASM_PHASHSIZE - 1);
+			if(tb[h] < 0) {tb[h] = x; continue;}
+			if(strcasecmp(nm, *(char * const *)((const char *)base + tb[h]*stride))) {break;}
+		}
+		if(x == n) {return 0;}
+	}
+	idleasm_error(IDLEASM_ERR_FAILED_EXIT, "no perfect hash seed found");
+	return 1;
+}
+
+void idleasm_hash_init(void) {
+	idleasm_phash_build(mnhash, &mnseed, mn, sizeof(mn[0]), arraysize(mn));
+	idleasm_phash_build(rhash, &rseed, r, sizeof(r[0]), arraysize(r));
+}
+
+int idleasm_streq(const char *s, unsigned n, const char *z) {
+	return strlen(z) == n && !strncasecmp(s, z, n);
+}
+
+int idleasm_findmn(const char *s, unsigned n) {
+	int16_t x = mnhash[idleasm_hash(s, n, mnseed) & (IDLEASM_PHASHSIZE - 1)];
+	return (x >= 0 && idleasm_streq(s, n, mn[x].name)) ? x : -1;
+}
+
+typedef struct tokspan_t {
+	size_t off;
+	unsigned len;
+	parser_token t;
+} tokspan_t;
+
 typedef struct lexstat_t {
-    char *token_matrix;
+	/*
+		* tokens are spans into the mapped source, nothing is copied
+		* LINE0 = offset of the current line, for columns in diagnostics
+	*/
+    const char *src;
+    size_t size;
+    tokspan_t *tok;
     unsigned token_count;
-    parser_token *token_int;
-    unsigned ipr;
-    unsigned mlp;
+    unsigned cap;
+    size_t line0;
+    idlearena_t *ar;
 } lexstat_t;
 /*
 int idleasm_endianness(void) {
@@ -330,42 +599,77 @@ int idleasm_swap64(uint64_t *w) {
 	return 0;
 }
 */
-void idleasm_lexstat_alloc(lexstat_t *st) {
-    st->token_count=0;
-    st->ipr=0;
-    st->mlp=2;
-    st->token_matrix = calloc(IDLEASM_TOKENCOUNT, IDLEASM_TOKENSIZE);
-    st->token_int = calloc(IDLEASM_TOKENCOUNT, sizeof(parser_token));
-    if(!st->token_matrix) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
-    if(!st->token_int) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+void *idleasm_aalloc(idlearena_t *a, size_t n) {
+	/*
+		* bump-pointer arena, every allocation of one assembly comes from here
+		* zeroed and 16-byte aligned, and idleasm_afree releases all of it
+	*/
+	arenablk_t *b = a->blk;
+	n = (n + 15) & ~(size_t)15;
+	if(!b || b->size - b->used < n) {
+		size_t sz = n > IDLEASM_ARENABLOCK ? n : IDLEASM_ARENABLOCK;
+		b = calloc(1, sizeof(arenablk_t) + sz);
+		if(!b) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+		b->size = sz;
+		b->next = a->blk;
+		a->blk = b;
+	}
+	b->used += n;
+	return &b->data[b->used - n];
+}
+
+void *idleasm_agrow(idlearena_t *a, void *p, size_t o, size_t n) {
+	void *q = idleasm_aalloc(a, n);
+	if(p) {memcpy(q, p, o);}
+	return q;
 }
 
-void idleasm_lexstat_initcopy(lexstat_t *dst, lexstat_t *src) {
-	dst->token_count=src->token_count;
-	dst->ipr=src->ipr;
-	dst->mlp = src->mlp;
-	dst->token_matrix = calloc(IDLEASM_TOKENCOUNT*(dst->mlp-1), IDLEASM_TOKENSIZE);
-	dst->token_int = calloc(IDLEASM_TOKENCOUNT*(dst->mlp-1), sizeof(parser_token));
+void idleasm_afree(idlearena_t *a) {
+	while(a->blk) {
+		arenablk_t *b = a->blk;
+		a->blk = b->next;
+		free(b);
+	}
+}
 
-	memcpy(dst->token_matrix, src->token_matrix, IDLEASM_TOKENCOUNT*(dst->mlp-1)*IDLEASM_TOKENSIZE);
-	memcpy(dst->token_int, src->token_int, IDLEASM_TOKENCOUNT*(dst->mlp-1)*sizeof(parser_token));
+void idleasm_lexstat_alloc(lexstat_t *st, idlearena_t *a, const char *src, size_t size) {
+    st->src = src;
+    st->size = size;
+    st->token_count = 0;
+    st->cap = IDLEASM_TOKENCOUNT;
+    st->line0 = 0;
+    st->ar = a;
+    st->tok = idleasm_aalloc(a, st->cap*sizeof(tokspan_t));
+}
 
-	if(!dst->token_matrix) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
-    if(!dst->token_int) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+void idleasm_tokclose(lexstat_t *st, ptrdiff_t *ts, size_t e) {
+	if(*ts < 0) {return;}
+	if(st->token_count >= st->cap) {
+		st->tok = idleasm_agrow(st->ar, st->tok, st->cap*sizeof(tokspan_t), 2*st->cap*sizeof(tokspan_t));
+		st->cap *= 2;
+	}
+	tokspan_t *t = &st->tok[st->token_count++];
+	t->off = (size_t)*ts;
+	t->len = (unsigned)(e - (size_t)*ts);
+	t->t = IDLEASM_PARSER_UNKNOWN;
+	*ts = -1;
+}
 
+const char *idleasm_tokp(lexstat_t *st, unsigned k) {
+	return &st->src[st->tok[k].off];
 }
 
-void idleasm_lexstat_realloc(lexstat_t *st) {
-    st->token_matrix = realloc(st->token_matrix, IDLEASM_TOKENCOUNT*IDLEASM_TOKENSIZE*st->mlp);
-    st->token_int = realloc(st->token_matrix, IDLEASM_TOKENCOUNT*sizeof(parser_token)*st->mlp);
+int idleasm_tokis(lexstat_t *st, unsigned k, const char *z) {
+	size_t l = strlen(z);
+	return k < st->token_count && st->tok[k].len == l && !memcmp(idleasm_tokp(st, k), z, l);
+}
 
-    if(!st->token_matrix) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
-    if(!st->token_int) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+parser_token idleasm_tokkind(lexstat_t *st, unsigned k) {
+	return k < st->token_count ? st->tok[k].t : IDLEASM_PARSER_UNKNOWN;
 }
 
-void idleasm_lexstat_free(lexstat_t *st) {
-    free(st->token_matrix);
-    free(st->token_int);
+void idleasm_tokpos(lexstat_t *st, unsigned k) {
+	if(k < st->token_count) {idleasm_pos.col = (unsigned)(st->tok[k].off - st->line0) + 1;}
 }
 
 int idleasm_bintable_build(const char *ign, const char *del, const char *swap, const char *incl, char *table) {
@@ -385,81 +689,146 @@ int idleasm_bintable_build(const char *ign, const char *del, const char *swap, c
     return 0;
 }
 
-int idleasm_token(const char *inpt, const char *table, lexstat_t *st) {
+/*
+	* a byte is special when its class in the bintable is not 0 (letter),
+	* the vector paths look the class up by nibbles: NHI has one bit per
+	* distinct high nibble of a special byte, NLO the bits of the high
+	* nibbles that the low nibble completes to a special byte
+*/
+uint8_t idleasm_nlo[16], idleasm_nhi[16];
+
+uint32_t idleasm_special_sw(const char *p, size_t n, const char *table) {
+	uint32_t m = 0;
+	for(size_t i = 0; i < n && i < 32; i++) {
+		m |= (uint32_t)(table[(unsigned char)p[i]] != 0) << i;
+	}
+	return m;
+}
+
+#ifdef IDLE_X86
+__attribute__((target("ssse3"))) uint32_t idleasm_special_ssse3(const char *p, size_t n, const char *table) {
+	const __m128i lo = _mm_loadu_si128((const __m128i *)idleasm_nlo);
+	const __m128i hi = _mm_loadu_si128((const __m128i *)idleasm_nhi);
+	const __m128i nb = _mm_set1_epi8(0x0f);
+	uint32_t m = 0;
+	for(int k = 0; k < 32; k += 16) {
+		__m128i c = _mm_loadu_si128((const __m128i *)(p + k));
+		__m128i a = _mm_shuffle_epi8(lo, _mm_and_si128(c, nb));
+		__m128i b = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(c, 4), nb));
+		__m128i z = _mm_cmpeq_epi8(_mm_and_si128(a, b), _mm_setzero_si128());
+		m |= (uint32_t)(~_mm_movemask_epi8(z) & 0xffff) << k;
+	}
+	return m;
+}
+
+__attribute__((target("avx2"))) uint32_t idleasm_special_avx2(const char *p, size_t n, const char *table) {
+	const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)idleasm_nlo));
+	const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)idleasm_nhi));
+	const __m256i nb = _mm256_set1_epi8(0x0f);
+	__m256i c = _mm256_loadu_si256((const __m256i *)p);
+	__m256i a = _mm256_shuffle_epi8(lo, _mm256_and_si256(c, nb));
+	__m256i b = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(c, 4), nb));
+	__m256i z = _mm256_cmpeq_epi8(_mm256_and_si256(a, b), _mm256_setzero_si256());
+	return ~(uint32_t)_mm256_movemask_epi8(z);
+}
+#endif
+
+uint32_t (*idleasm_special)(const char *p, size_t n, const char *table) = idleasm_special_sw;
+
+void idleasm_special_init(const char *table) {
+	/* the nibble tables hold at most 8 distinct high nibbles, otherwise stay scalar */
+	unsigned k = 0;
+	memset(idleasm_nlo, 0, sizeof(idleasm_nlo));
+	memset(idleasm_nhi, 0, sizeof(idleasm_nhi));
+	for(unsigned h = 0; h < 16; h++) {
+		for(unsigned l = 0; l < 16; l++) {
+			if(!table[h << 4 | l]) {continue;}
+			if(!idleasm_nhi[h]) {
+				if(k == 8) {return;}
+				idleasm_nhi[h] = (uint8_t)(1u << k++);
+			}
+			idleasm_nlo[l] |= idleasm_nhi[h];
+		}
+	}
+#ifdef IDLE_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("ssse3")) {idleasm_special = idleasm_special_ssse3;}
+	if(__builtin_cpu_supports("avx2")) {idleasm_special = idleasm_special_avx2;}
+#endif
+}
+
+int idleasm_token(const char *table, lexstat_t *st, size_t b, size_t e) {
 	/*
-		* IS = string pointer
-		* ITX = matrix pointer by X
-		* ITY = matrix pointer by Y
+		* splits the line [B, E) of the source into token spans, 32 bytes
+		* are classified at a time and only special bytes and the first
+		* letter of every run are stepped through, further letters of a
+		* run never change the state
+		* TS = start of the open token, -1 when none is open
 		* TG = swap mode
 		* IC = include all mode
-		* RSV = check if memory for token reserved
-		* MLP = blocks count
+		* CY = last byte of the previous block was special
 	*/
-    int is, itx=0, ity=0, tg=0, ic=0, rsv=1;
+	const char *s = st->src; ptrdiff_t ts = -1; int tg = 0, ic = 0; uint32_t cy = 1;
 
-    /*
+	/*
 		* CASE 0: character is letter
 		* CASE 1: character is ignorable
 		* CASE 2: character is delimiter
 		* CASE 3: character is swap character
 		* CASE 4: character is including all character
-    */
-
-    for(is = 0; inpt[is] != 0; is++) {
-        switch(table[(unsigned char)inpt[is]]) {
-            case 0:
-                if(ity >= IDLEASM_TOKENSIZE) {ity=0; itx+=1;} if(itx >= IDLEASM_TOKENCOUNT) {idleasm_lexstat_realloc(st);}
-                if(ic) {st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = inpt[is]; ity++; break;}
-                if(tg) {
-                    tg=0;
-                    if(!rsv) {st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = 0; itx+=1; ity=0; rsv=1;}
-                }
-
-                st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = inpt[is]; ity++; rsv=0;
-
-                break;
-            case 1:
-                if(ity >= IDLEASM_TOKENSIZE) {ity=0; itx+=1;} if(itx >= IDLEASM_TOKENCOUNT) {idleasm_lexstat_realloc(st);}
-                if(ic) {st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = inpt[is]; ity++; break;}
-                if(!rsv) {itx+=1; ity=0; rsv=1;}
-                break;
-            case 2:
-                if(ity >= IDLEASM_TOKENSIZE) {ity=0; itx+=1;} if((itx+1) >= IDLEASM_TOKENCOUNT) {idleasm_lexstat_realloc(st);}
-                if(ic) {st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = inpt[is]; ity++; break;}
-                if(!rsv) {st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = 0; itx+=1; ity=0;}
-                st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = inpt[is]; ity++;
-                st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = 0; itx+=1; ity=0; rsv=1;
-                break;
-            case 3:
-                if(ity >= IDLEASM_TOKENSIZE) {ity=0; itx+=1;} if(itx >= IDLEASM_TOKENCOUNT) {idleasm_lexstat_realloc(st);}
-                if(ic) {st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = inpt[is]; ity++; break;}
-                if(!tg) {
-                    tg=1;
-                    if(!rsv) {st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = 0; itx+=1; ity=0; rsv=1;}
-                }
-
-                st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = inpt[is]; ity++; rsv=0;
-
-                break;
-            case 4:
-            	if(is > 0 && inpt[is-1] == '\\') {st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = inpt[is]; ity++; break;}
-                if(ity >= IDLEASM_TOKENSIZE) {ity=0; itx+=1;} if(itx >= IDLEASM_TOKENCOUNT) {idleasm_lexstat_realloc(st);}
-                st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = inpt[is]; ity++;
-                if(ic) {st->token_matrix[(itx * IDLEASM_TOKENSIZE) + ity] = 0; itx+=1; ity=0; rsv=1;}
-                ic = !ic;
-        }
-    }
+	*/
 
-    st->token_count = itx;
+	st->token_count = 0;
+	st->line0 = b;
+
+	for(size_t q = b; q < e; q += 32) {
+		size_t w = e - q < 32 ? e - q : 32;
+		uint32_t v = w < 32 ? (UINT32_C(1) << w) - 1 : UINT32_MAX;
+		uint32_t m = (q + 32 <= st->size ? idleasm_special(&s[q], w, table) : idleasm_special_sw(&s[q], w, table)) & v;
+		uint32_t ev = m | (~m & v & ((m << 1) | cy));
+		cy = m >> 31;
+		for(; ev; ev &= ev - 1) {
+			size_t is = q + (size_t)__builtin_ctz(ev);
+			switch(table[(unsigned char)s[is]]) {
+				case 0:
+					if(ic) {break;}
+					if(tg) {tg = 0; idleasm_tokclose(st, &ts, is);}
+					if(ts < 0) {ts = (ptrdiff_t)is;}
+					break;
+				case 1:
+					if(!ic) {idleasm_tokclose(st, &ts, is);}
+					break;
+				case 2:
+					if(ic) {break;}
+					idleasm_tokclose(st, &ts, is);
+					ts = (ptrdiff_t)is; idleasm_tokclose(st, &ts, is + 1);
+					break;
+				case 3:
+					if(ic) {break;}
+					if(!tg) {tg = 1; idleasm_tokclose(st, &ts, is);}
+					if(ts < 0) {ts = (ptrdiff_t)is;}
+					break;
+				case 4:
+					if(ts < 0) {ts = (ptrdiff_t)is;}
+					if(is > b && s[is-1] == '\\') {break;}
+					if(ic) {idleasm_tokclose(st, &ts, is + 1);}
+					ic = !ic;
+			}
+		}
+	}
 
-    return 0;
+	if(!ic) {idleasm_tokclose(st, &ts, e);}
+
+	return 0;
 }
 
-int idleasm_inttype(const char *src, int *minus) {
-    int l = strlen(src)-1;
+int idleasm_inttype(const char *src, unsigned n, int *minus) {
+    int l = (int)n - 1;
 
     if(l+1 == 0) {return 0x00;}
 
+    char c1 = n > 1 ? src[1] : 0, c2 = n > 2 ? src[2] : 0;
+
     *minus = 0;
 
 	switch(src[l]) {
@@ -485,7 +854,7 @@ int idleasm_inttype(const char *src, int *minus) {
 		default:
 			switch(src[0]) {
 				case '0':
-					switch(src[1]) {
+					switch(c1) {
 						case 'h': case 'x':
 							for(int i = 2; i < (l+1); i++) {
 								if(!isxdigit((int)src[i])) {return 0x00;}
@@ -512,9 +881,9 @@ int idleasm_inttype(const char *src, int *minus) {
 					}
 				case '-':
 					*minus = 1;
-					switch(src[1]) {
+					switch(c1) {
 						case '0':
-							switch(src[2]) {
+							switch(c2) {
 								case 'h': case 'x':
 									for(int i = 3; i < (l+1); i++) {
 										if(!isxdigit((int)src[i])) {return 0x00;}
@@ -552,57 +921,50 @@ int idleasm_inttype(const char *src, int *minus) {
     }
 }
 
+/* digit value + 1, 0 marks a byte that is no digit */
+const uint8_t idleasm_digit[256] = {
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16
+};
+
+int idleasm_swar8(const char *s, uint64_t *v) {
+	/* eight decimal digits at once, the first digit lands in the low byte */
+	uint64_t c;
+	memcpy(&c, s, sizeof(c));
+	if(((c + UINT64_C(0x4646464646464646)) | (c - UINT64_C(0x3030303030303030))) & UINT64_C(0x8080808080808080)) {return 0;}
+	c -= UINT64_C(0x3030303030303030);
+	c = (c * 10) + (c >> 8);
+	c = (((c & UINT64_C(0x000000ff000000ff)) * (100 + (UINT64_C(1000000) << 32))) + (((c >> 16) & UINT64_C(0x000000ff000000ff)) * (1 + (UINT64_C(10000) << 32)))) >> 32;
+	*v = c;
+	return 1;
+}
+
 int idleasm_intconv(const char *s, uint64_t *i, unsigned n, uint64_t base, int sign) {
+	uint64_t v = 0, w; unsigned j = 0;
 	*i = 0;
 	if(n == 0) {return 1;}
-	uint64_t m = 1;
-	for(unsigned j = 0, k = (n - 1); j < n; j++, k--) {
-		if(s[k] == 0) {return 0;}
-		switch(s[k]) {
-		case '0':
-			*i += 0; m*=base; break;
-		case '1':
-			*i += m; m*=base; break;
-		case '2':
-			*i += 2*m; m*=base; break;
-		case '3':
-			*i += 3*m; m*=base; break;
-		case '4':
-			*i += 4*m; m*=base; break;
-		case '5':
-			*i += 5*m; m*=base; break;
-		case '6':
-			*i += 6*m; m*=base; break;
-		case '7':
-			*i += 7*m; m*=base; break;
-		case '8':
-			*i += 8*m; m*=base; break;
-		case '9':
-			*i += 9*m; m*=base; break;
-		case 'A': case 'a':
-			*i += 10*m; m*=base; break;
-		case 'B': case 'b':
-			*i += 11*m; m*=base; break;
-		case 'C': case 'c':
-			*i += 12*m; m*=base; break;
-		case 'D': case 'd':
-			*i += 13*m; m*=base; break;
-		case 'E': case 'e':
-			*i += 14*m; m*=base; break;
-		case 'F': case 'f':
-			*i += 15*m; m*=base; break;
-		default:
-			idleasm_error(IDLEASM_ERR_INTEGER_CONST_ISNT_VALID, "unknown digit in integer constant");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	for(; base == 10 && j + 8 <= n && idleasm_swar8(&s[j], &w); j += 8) {
+		if(__builtin_mul_overflow(v, UINT64_C(100000000), &v) || __builtin_add_overflow(v, w, &v)) {
+			idleasm_error(IDLEASM_ERR_INTEGER_CONST_ISNT_VALID, "integer constant does not fit into 64 bits");
 		}
 	}
-
-	if(sign) {*i = -(*i);}
+#endif
+	for(; j < n; j++) {
+		w = (uint64_t)idleasm_digit[(unsigned char)s[j]] - 1;
+		if(w >= base) {idleasm_error(IDLEASM_ERR_INTEGER_CONST_ISNT_VALID, "unknown digit in integer constant");}
+		if(__builtin_mul_overflow(v, base, &v) || __builtin_add_overflow(v, w, &v)) {
+			idleasm_error(IDLEASM_ERR_INTEGER_CONST_ISNT_VALID, "integer constant does not fit into 64 bits");
+		}
+	}
+	*i = sign ? -v : v;
 	return 0;
 }
 
-int idleasm_intform(const char *s, uint64_t *i) {
-	unsigned l = strlen(s); int q;
-	switch(idleasm_inttype(s, &q)) {
+int idleasm_intform(const char *s, unsigned l, uint64_t *i) {
+	int q;
+	switch(idleasm_inttype(s, l, &q)) {
 	case 0x01:
 		return idleasm_intconv(s, i, l, 10, q);
 	case 0x02:
@@ -629,25 +991,28 @@ int idleasm_intform(const char *s, uint64_t *i) {
 	return 1;
 }
 
-int idleasm_build_finddata(unsigned *i, char *name, int arg0, int arg1) {
-	int l0=0, l1=0, l2=0;
-	for(unsigned x = 0; x < arraysize(mn); x++) {
-		l0= !strcasecmp(name, mn[x].name);
+int idleasm_build_finddata(unsigned *i, const char *name, unsigned n, int arg0, int arg1, int arg2) {
+	/* overloads of one mnemonic are contiguous in mn[], the hash yields the first */
+	int l0=0, l1=0, l2=0, l3=0, f = idleasm_findmn(name, n);
+	if(f < 0) {return 1;}
+	for(unsigned x = f; x < arraysize(mn); x++) {
+		l0= !strcmp(mn[f].name, mn[x].name);
+		if(!l0) {break;}
 		l1= arg0==mn[x].at0;
 		l2= arg1==mn[x].at1;
-		if(l0 & l1 & l2) {*i = x; return 0;}
+		l3= arg2==mn[x].at2;
+		if(l0 & l1 & l2 & l3) {*i = x; return 0;}
 	}
 	return 1;
 }
 
-int isident_str(const char *s) {
-	unsigned l = strlen(s);
-	if(!((isalpha(s[0])) || (s[0] == '_'))) {
+int isident_str(const char *s, unsigned l) {
+	if(!l || !((isalpha((unsigned char)s[0])) || (s[0] == '_'))) {
 		return 0;
 	}
 	if(l > 1) {
-		for(unsigned i = 1; s[i] != 0; i++) {
-			if(!((isalnum(s[i])) || (s[i] == '_'))) {
+		for(unsigned i = 1; i < l; i++) {
+			if(!((isalnum((unsigned char)s[i])) || (s[i] == '_'))) {
 				return 0;
 			}
 		}
@@ -655,135 +1020,365 @@ int isident_str(const char *s) {
 	return 1;
 }
 
-int isoperand_str(const char *s) {
-	for(unsigned i = 0; i < arraysize(mn); i++) {
-		if(!strcasecmp(s, mn[i].name)) {
-			return 1;
-		}
-	}
-	return 0;
+int isoperand_str(const char *s, unsigned l) {
+	return idleasm_findmn(s, l) >= 0;
 }
 
-int isregister_str(const char *s) {
-	for(unsigned i = 0; i < arraysize(r); i++) {
-		if(!strcasecmp(s, r[i].mnemonic)) {
-			return 1;
-		}
-	}
-	return 0;
+int isregister_str(const char *s, unsigned l) {
+	int16_t x = rhash[idleasm_hash(s, l, rseed) & (IDLEASM_PHASHSIZE - 1)];
+	return x >= 0 && idleasm_streq(s, l, r[x].mnemonic);
 }
 
-int isstring_str(const char *s) {
-	unsigned l = strlen(s);
-	if(s[0] == '\"' && s[l-1] == '\"') {return 1;}
+int isstring_str(const char *s, unsigned l) {
+	if(l && s[0] == '\"' && s[l-1] == '\"') {return 1;}
 	return 0;
 }
 
-void idleasm_prmalloc(idleprm_t *prm) {
+void idleasm_prmalloc(idleprm_t *prm, FILE *out) {
+	/*
+		* with OUT set every slot is written as soon as it is encoded and only
+		* labels and pending forward references stay in memory, otherwise the
+		* slots are kept in SVD for the optimiser
+	*/
+	prm->ar.blk = NULL;
 	prm->iptr = 0;
 	prm->isvd = 0;
+	prm->ifix = 0;
 	prm->mlp = 2;
-	prm->lbl = calloc(IDLEASM_LABELCOUNT, sizeof(labelstat_t));
-	prm->svd = calloc(IDLEASM_SVDCOUNT, sizeof(opsvd_t));
-	for(unsigned a = 0; a < IDLEASM_LABELCOUNT; a++) {
-		prm->lbl[a].lb_name = malloc(IDLEASM_TOKENSIZE);
-		if(!prm->lbl[a].lb_name) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
-	}
-	if(!prm->lbl) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
-	if(!prm->svd) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+	prm->hcap = 2*IDLEASM_LABELCOUNT;
+	prm->fcap = IDLEASM_LABELCOUNT;
+	prm->out = out;
+	prm->svd = NULL;
+	prm->flg = NULL;
+	prm->lbl = NULL;
+	prm->lbt = NULL;
+	prm->lin = NULL;
+	prm->ncap = 0;
+	prm->defer = 0;
+	prm->absref = 0;
+	prm->depth = 0;
+	prm->ncst = 0;
+	prm->table = NULL;
+	prm->mdef = NULL;
+	prm->mac = NULL;
+	prm->imp = NULL;
+	prm->nimp = 0;
+	prm->zw = NULL;
+	prm->zp = NULL;
+	prm->nzp = 0;
+	prm->zip = 0;
+	prm->lht = idleasm_aalloc(&prm->ar, prm->hcap*sizeof(labelstat_t *));
+	prm->fix = idleasm_aalloc(&prm->ar, prm->fcap*sizeof(fixstat_t));
+	if(out) {return;}
+	prm->svd = idleasm_aalloc(&prm->ar, IDLEASM_SVDCOUNT*sizeof(opsvd_t));
+	prm->flg = idleasm_aalloc(&prm->ar, IDLEASM_SVDCOUNT*sizeof(uint8_t));
 }
 
 void idleasm_prmrealloc(idleprm_t *prm) {
-	prm->lbl = realloc(prm->lbl, IDLEASM_LABELCOUNT*sizeof(labelstat_t)*prm->mlp);
-	prm->svd = realloc(prm->svd, IDLEASM_SVDCOUNT*sizeof(opsvd_t)*prm->mlp);
-	prm->mlp += 1;
-	for(unsigned a = IDLEASM_LABELCOUNT*(prm->mlp-2); a < IDLEASM_LABELCOUNT*(prm->mlp-1); a++) {
-		prm->lbl[a].lb_name = malloc(IDLEASM_TOKENSIZE);
-		if(!prm->lbl[a].lb_name) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
-	}
-	if(!prm->lbl) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
-	if(!prm->svd) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+	prm->svd = idleasm_agrow(&prm->ar, prm->svd, IDLEASM_SVDCOUNT*sizeof(opsvd_t)*(prm->mlp-1), IDLEASM_SVDCOUNT*sizeof(opsvd_t)*2*(prm->mlp-1));
+	prm->flg = idleasm_agrow(&prm->ar, prm->flg, IDLEASM_SVDCOUNT*sizeof(uint8_t)*(prm->mlp-1), IDLEASM_SVDCOUNT*sizeof(uint8_t)*2*(prm->mlp-1));
+	prm->mlp = 2*(prm->mlp-1) + 1;
 }
 
 void idleasm_prmfree(idleprm_t *prm) {
-	for(unsigned a = 0; a < IDLEASM_LABELCOUNT; a++) {
-		free(prm->lbl[a].lb_name);
+	idleasm_afree(&prm->ar);
+}
+
+labelstat_t **idleasm_lhtslot(idleprm_t *prm, const char *name, unsigned l, uint32_t h) {
+	/* open addressing over the interned identifiers, NULL marks a free slot */
+	for(uint32_t k = h;; k++) {
+		labelstat_t **e = &prm->lht[k & (prm->hcap - 1)];
+		if(!*e || ((*e)->hash == h && (*e)->len == l && !memcmp((*e)->lb_name, name, l))) {return e;}
+	}
+}
+
+labelstat_t *idleasm_intern(idleprm_t *prm, const char *name, unsigned l) {
+	/*
+		* identifiers are interned once, a label and every reference to it
+		* share one record that stays undefined until the label is seen,
+		* the name points into the mapped source
+	*/
+	uint32_t h = idleasm_hash(name, l, 0);
+	labelstat_t **e = idleasm_lhtslot(prm, name, l, h);
+	if(*e) {return *e;}
+	labelstat_t *lb = idleasm_aalloc(&prm->ar, sizeof(labelstat_t));
+	lb->lb_name = name;
+	lb->len = l;
+	lb->hash = h;
+	*e = lb;
+	if(prm->lbt) {prm->lbt->next = lb;} else {prm->lbl = lb;}
+	prm->lbt = lb;
+	if(2*(++prm->iptr) > prm->hcap) {
+		prm->hcap *= 2;
+		prm->lht = idleasm_aalloc(&prm->ar, prm->hcap*sizeof(labelstat_t *));
+		for(labelstat_t *a = prm->lbl; a; a = a->next) {*idleasm_lhtslot(prm, a->lb_name, a->len, a->hash) = a;}
+	}
+	return lb;
+}
+
+int idleasm_build_label(idleprm_t *prm, const char *name, unsigned l, unsigned ln) {
+	labelstat_t *lb = idleasm_intern(prm, name, l);
+	if(lb->def) {return 0;}
+	lb->def = 1;
+	lb->ln = ln;
+	return 0;
+}
+
+fixstat_t *idleasm_addfix(idleprm_t *prm) {
+	if(prm->ifix >= prm->fcap) {
+		prm->fix = idleasm_agrow(&prm->ar, prm->fix, prm->fcap*sizeof(fixstat_t), 2*prm->fcap*sizeof(fixstat_t));
+		prm->fcap *= 2;
 	}
-	free(prm->lbl);
-	free(prm->svd);
+	fixstat_t *f = &prm->fix[prm->ifix++];
+	f->lb = NULL;
+	f->kind = IDLEASM_FIX_REL;
+	f->pos = idleasm_pos;
+	f->slot = prm->isvd;
+	return f;
+}
+
+int idleasm_build_fixup(idleprm_t *prm, const char *name, unsigned l) {
+	idleasm_addfix(prm)->lb = idleasm_intern(prm, name, l);
+	return 0;
 }
 
-int idleasm_build_label(idleprm_t *prm, char *name, unsigned ln) {
-	if(prm->iptr >= IDLEASM_LABELCOUNT*(prm->mlp-1)) {idleasm_prmrealloc(prm);}
-	strncpy(prm->lbl[prm->iptr].lb_name, name, IDLEASM_TOKENSIZE);
-	prm->lbl[prm->iptr++].ln = ln;
+int idleasm_build_exprfix(idleprm_t *prm, unsigned kind, const char *s, unsigned l) {
+	fixstat_t *f = idleasm_addfix(prm);
+	f->kind = kind;
+	f->lb = idleasm_aalloc(&prm->ar, sizeof(labelstat_t));
+	f->lb->lb_name = s;
+	f->lb->len = l;
 	return 0;
 }
 
-int idleasm_build_binary(idleprm_t *prm, char *mnemonic, int targ0, int targ1, uint8_t a0, uint8_t a1, uint32_t imm) {
+typedef struct exprstat_t {
+	/* PEND = some label of the expression is not known yet */
+	idleprm_t *prm;
+	const char *s;
 	unsigned i;
-	if(idleasm_build_finddata(&i, mnemonic, targ0, targ1)) {idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "invalid instruction");}
+	unsigned n;
+	int pend;
+} exprstat_t;
+
+const opboard_t *idleasm_exprop(exprstat_t *x) {
+	/* the longest operator of opbrd at the cursor, << before < */
+	const opboard_t *o = NULL; size_t ol = 0;
+	while(x->i < x->n && isspace((unsigned char)x->s[x->i])) {x->i++;}
+	for(unsigned k = 0; k < sizeof(opbrd)/sizeof(opbrd[0]); k++) {
+		size_t l = strlen(opbrd[k].name);
+		if(l > ol && x->i + l <= x->n && !memcmp(&x->s[x->i], opbrd[k].name, l)) {o = &opbrd[k]; ol = l;}
+	}
+	return o;
+}
+
+uint64_t idleasm_exprident(exprstat_t *x, const char *name, unsigned l) {
+	/*
+		* a constant stands for its value and a label for its absolute slot,
+		* a label that is not defined yet leaves the expression pending
+	*/
+	labelstat_t *lb = idleasm_intern(x->prm, name, l);
+	if(lb->cst == IDLEASM_NAME_CONST) {return lb->ln;}
+	if(lb->cst || isregister_str(name, l)) {idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "identifier is not a value");}
+	x->prm->absref = 1;
+	if(lb->def && !x->prm->defer) {return lb->ln;}
+	x->pend = 1;
+	return 0;
+}
+
+uint64_t idleasm_exprbin(exprstat_t *x, int p);
+
+uint64_t idleasm_exprunary(exprstat_t *x) {
+	const opboard_t *o = idleasm_exprop(x); uint64_t a;
+	if(o && o->unary) {
+		x->i += (unsigned)strlen(o->name);
+		a = idleasm_exprunary(x);
+		return o->t == IDLEASM_PARSER_TILDA ? ~a : -a;
+	}
+	if(o && o->t == IDLEASM_PARSER_LROUNDBR) {
+		x->i++;
+		a = idleasm_exprbin(x, 1);
+		o = idleasm_exprop(x);
+		if(!o || o->t != IDLEASM_PARSER_RROUNDBR) {idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "missing ) in expression");}
+		x->i++;
+		return a;
+	}
+	unsigned b = x->i;
+	while(x->i < x->n && (isalnum((unsigned char)x->s[x->i]) || x->s[x->i] == '_')) {x->i++;}
+	if(b == x->i) {idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "operand expected in expression");}
+	if(isdigit((unsigned char)x->s[b])) {
+		idleasm_intform(&x->s[b], x->i - b, &a);
+		return a;
+	}
+	return idleasm_exprident(x, &x->s[b], x->i - b);
+}
+
+uint64_t idleasm_exprbin(exprstat_t *x, int p) {
+	/* precedence climbing over the priorities of opbrd, all operators are left associative */
+	uint64_t a = idleasm_exprunary(x), b;
+	for(;;) {
+		const opboard_t *o = idleasm_exprop(x);
+		if(!o || o->unary == 1 || o->priority < p || o->t == IDLEASM_PARSER_LROUNDBR || o->t == IDLEASM_PARSER_RROUNDBR) {return a;}
+		x->i += (unsigned)strlen(o->name);
+		b = idleasm_exprbin(x, o->priority + 1);
+		switch(o->t) {
+		case IDLEASM_PARSER_PLUS: a += b; break;
+		case IDLEASM_PARSER_MINUS: a -= b; break;
+		case IDLEASM_PARSER_STAR: a *= b; break;
+		case IDLEASM_PARSER_SLASH:
+		case IDLEASM_PARSER_MODULE:
+			if(!b) {
+				if(x->pend) {break;}
+				idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "division by zero in expression");
+			}
+			a = o->t == IDLEASM_PARSER_SLASH ? a / b : a % b;
+			break;
+		case IDLEASM_PARSER_VERTICAL: a |= b; break;
+		case IDLEASM_PARSER_CARRIAGE: a ^= b; break;
+		case IDLEASM_PARSER_AMPERSAND: a &= b; break;
+		case IDLEASM_PARSER_LSHIFT: a = b > 63 ? 0 : a << b; break;
+		case IDLEASM_PARSER_RSHIFT: a = b > 63 ? 0 : a >> b; break;
+		default: break;
+		}
+	}
+}
+
+int idleasm_expr(idleprm_t *prm, const char *s, unsigned n, uint64_t *v) {
+	/*
+		* folds the constant expression S of N bytes into V with 64-bit
+		* wrap-around, returns 1 when it names a label that is not known yet
+	*/
+	exprstat_t x = {prm, s, 0, n, 0};
+	*v = idleasm_exprbin(&x, 1);
+	if(idleasm_exprop(&x) || x.i != x.n) {idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "unexpected text in expression");}
+	return x.pend;
+}
+
+int idleasm_emit(idleprm_t *prm, const opsvd_t *o, uint8_t f) {
+	if(prm->ncap) {
+		/* debug line table, one source line per slot */
+		if(prm->isvd >= prm->ncap) {
+			prm->lin = idleasm_agrow(&prm->ar, prm->lin, prm->ncap*sizeof(uint32_t), 2*prm->ncap*sizeof(uint32_t));
+			prm->ncap *= 2;
+		}
+		prm->lin[prm->isvd] = idleasm_pos.line;
+	}
+	if(prm->out) {
+		if(fwrite(o, sizeof(opsvd_t), 1, prm->out) != 1) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+		prm->isvd += 1;
+		return 0;
+	}
 	if(prm->isvd >= IDLEASM_SVDCOUNT*(prm->mlp-1)) {idleasm_prmrealloc(prm);}
-	prm->svd[prm->isvd].op = mn[i].op;
-	prm->svd[prm->isvd].arg0 = a0;
-	prm->svd[prm->isvd].arg1 = a1;
-	prm->svd[prm->isvd].imm = imm;
+	prm->svd[prm->isvd] = *o;
+	prm->flg[prm->isvd] = f;
 	prm->isvd += 1;
 	return 0;
 }
 
+int idleasm_build_binary(idleprm_t *prm, const char *mnemonic, unsigned l, int targ0, int targ1, int targ2, uint8_t a0, uint8_t a1, uint32_t imm) {
+	unsigned i; opsvd_t o;
+	if(idleasm_build_finddata(&i, mnemonic, l, targ0, targ1, targ2)) {idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "invalid instruction");}
+	o.op = mn[i].op;
+	o.arg0 = a0;
+	o.arg1 = a1;
+	o.imm = imm;
+	return idleasm_emit(prm, &o, 0);
+}
+
 int idleasm_id_directive(idleprm_t *prm, uint64_t w) {
-	((uint64_t *)prm->svd)[prm->isvd] = w;
-	prm->isvd += 1;
+	opsvd_t o;
+	memcpy(&o, &w, sizeof(opsvd_t));
+	return idleasm_emit(prm, &o, IDLEASM_SLOT_DATA);
+}
+
+int idleasm_isconst(idleprm_t *prm, const char *name, unsigned l) {
+	if(!prm->ncst) {return 0;}
+	labelstat_t *lb = *idleasm_lhtslot(prm, name, l, idleasm_hash(name, l, 0));
+	return lb && lb->cst == IDLEASM_NAME_CONST;
+}
+
+int idleasm_tokop(lexstat_t *st, unsigned k) {
+	/* 1 for ',' and ';', 2 for operators like << or a round bracket */
+	char c = st->src[st->tok[k].off];
+	if(st->tok[k].len == 1 && (c == ',' || c == ';')) {return 1;}
+	return c && strchr("+-*/%|^&~<>()", c) ? 2 : 0;
+}
+
+int idleasm_enumexpr(lexstat_t *st, idleprm_t *prm, unsigned S) {
+	/*
+		* an operand of several tokens joined by operators is a constant
+		* expression, it becomes one EXPR token spanning its source text so
+		* that operands stay at S+1, S+3, S+5, a lone name of an equ
+		* constant is one as well
+	*/
+	for(unsigned k = S + 1, m; k < st->token_count; k = m + 1) {
+		for(m = k; m < st->token_count && idleasm_tokop(st, m) != 1; m++) {
+			if(m > k && !idleasm_tokop(st, m - 1) && !idleasm_tokop(st, m)) {return 0;}
+		}
+		if(m - k == 1 && idleasm_isconst(prm, idleasm_tokp(st, k), st->tok[k].len)) {st->tok[k].t = IDLEASM_PARSER_EXPR;}
+		if(m - k > 1) {
+			st->tok[k].len = (unsigned)(st->tok[m-1].off + st->tok[m-1].len - st->tok[k].off);
+			st->tok[k].t = IDLEASM_PARSER_EXPR;
+			memmove(&st->tok[k+1], &st->tok[m], (st->token_count - m)*sizeof(tokspan_t));
+			st->token_count -= m - k - 1;
+			m = k + 1;
+		}
+		if(m >= st->token_count || st->src[st->tok[m].off] == ';') {break;}
+	}
 	return 0;
 }
 
-int idleasm_enuminstr(lexstat_t *st, unsigned *i) {
-	int q = 0, y = 0; uint64_t num = 0; unsigned S = *i;
+int idleasm_enuminstr(lexstat_t *st, idleprm_t *prm, unsigned *i) {
+	int q = 0; unsigned S = *i;
 	if((st->token_count - S) < 2) {return 0;}
-	if(isoperand_str(&st->token_matrix[(*i)*IDLEASM_TOKENSIZE])) {
-		st->token_int[S] = IDLEASM_PARSER_OPC;
-		if(!strcmp(&st->token_matrix[(S+1)*IDLEASM_TOKENSIZE], ";\0")) {st->token_int[S+1] = IDLEASM_PARSER_SEMICOLON; return 0;}
+	if(isoperand_str(idleasm_tokp(st, S), st->tok[S].len)) {
+		st->tok[S].t = IDLEASM_PARSER_OPC;
+		idleasm_enumexpr(st, prm, S);
+		if(idleasm_tokis(st, S+1, ";")) {st->tok[S+1].t = IDLEASM_PARSER_SEMICOLON; return 0;}
 		if((st->token_count - (S + 1)) % 2) {
 			idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "incorrect instruction");
 		}
 		for(unsigned k = S + 1; k < st->token_count; k+=2) {
-			if(isregister_str(&st->token_matrix[k*IDLEASM_TOKENSIZE])) {
-				st->token_int[k] = IDLEASM_PARSER_REG;
+			const char *a = idleasm_tokp(st, k); unsigned l = st->tok[k].len;
+			idleasm_tokpos(st, k);
+			if(st->tok[k].t == IDLEASM_PARSER_EXPR) {}
+			else if(isregister_str(a, l)) {
+				st->tok[k].t = IDLEASM_PARSER_REG;
 			}
-			else if(isstring_str(&st->token_matrix[k*IDLEASM_TOKENSIZE])) {
-				st->token_int[k] = IDLEASM_PARSER_STRING;
+			else if(isstring_str(a, l)) {
+				st->tok[k].t = IDLEASM_PARSER_STRING;
 			}
-			else if(isident_str(&st->token_matrix[k*IDLEASM_TOKENSIZE])) {
-				st->token_int[k] = IDLEASM_PARSER_IDENT;
+			else if(isident_str(a, l)) {
+				st->tok[k].t = IDLEASM_PARSER_IDENT;
 			}
-			else if(idleasm_inttype(&st->token_matrix[k*IDLEASM_TOKENSIZE], &q)) {
-				st->token_int[k] = IDLEASM_PARSER_INTEGER;
+			else if(idleasm_inttype(a, l, &q)) {
+				st->tok[k].t = IDLEASM_PARSER_INTEGER;
 			}
 			else {
 				idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "unknown type of argument");
 			}
-			if(!strcmp(&st->token_matrix[(k+1)*IDLEASM_TOKENSIZE], ";\0")) {st->token_int[k+1] = IDLEASM_PARSER_SEMICOLON; break;}
-			if(!strcmp(&st->token_matrix[(k+1)*IDLEASM_TOKENSIZE], ",\0")) {st->token_int[k+1] = IDLEASM_PARSER_COMMA;}
+			if(idleasm_tokis(st, k+1, ";")) {st->tok[k+1].t = IDLEASM_PARSER_SEMICOLON; break;}
+			if(idleasm_tokis(st, k+1, ",")) {st->tok[k+1].t = IDLEASM_PARSER_COMMA;}
 			else {idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "unknown separator");}
 		}
+		idleasm_tokpos(st, S);
 	}
 	return 0;
 }
 
 int idleasm_enumtag(lexstat_t *st, unsigned *i) {
 	if(st->token_count < 2) {idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "incorrect instruction");}
-	if(isident_str(&st->token_matrix[0]) && !strcmp(&st->token_matrix[IDLEASM_TOKENSIZE], ":\0")) {
-		st->token_int[0] = IDLEASM_PARSER_TAG; st->token_int[1] = IDLEASM_PARSER_COLON; *i = 2; return 0;
+	if(isident_str(idleasm_tokp(st, 0), st->tok[0].len) && idleasm_tokis(st, 1, ":")) {
+		st->tok[0].t = IDLEASM_PARSER_TAG; st->tok[1].t = IDLEASM_PARSER_COLON; *i = 2; return 0;
 	}
-	if(!strcmp(&st->token_matrix[IDLEASM_TOKENSIZE], ":\0")) {idleasm_error(IDLEASM_ERR_LABEL_NAME_IS_NOT_IDENT, "label name is not identifier");}
+	if(idleasm_tokis(st, 1, ":")) {idleasm_error(IDLEASM_ERR_LABEL_NAME_IS_NOT_IDENT, "label name is not identifier");}
 	return 0;
 }
 
-int idleasm_enumerator(lexstat_t *st) {
+int idleasm_enumerator(lexstat_t *st, idleprm_t *prm) {
 	unsigned i = 0;
+	idleasm_tokpos(st, 0);
 	idleasm_enumtag(st, &i);
-	idleasm_enuminstr(st, &i);
+	idleasm_enuminstr(st, prm, &i);
 	return 0;
 }
 
@@ -792,6 +1387,7 @@ unsigned idleasm_ett(unsigned i) {
 	case IDLEASM_PARSER_FLOAT:
 		return IDLEASM_TYPE_FLOAT;
 	case IDLEASM_PARSER_INTEGER:
+	case IDLEASM_PARSER_EXPR:
 		return IDLEASM_TYPE_IMM;
 	case IDLEASM_PARSER_REG:
 		return IDLEASM_TYPE_REG;
@@ -803,101 +1399,222 @@ unsigned idleasm_ett(unsigned i) {
 }
 
 unsigned idleasm_getopc(lexstat_t *st) {
-	return st->token_int[0] == IDLEASM_PARSER_TAG ? 2 : 0;
+	return idleasm_tokkind(st, 0) == IDLEASM_PARSER_TAG ? 2 : 0;
 }
 
-int idleasm_getarg(lexstat_t *st, int *arg0, int *arg1) {
+int idleasm_getarg(lexstat_t *st, int *arg0, int *arg1, int *arg2) {
 	unsigned i = idleasm_getopc(st);
-	if(st->token_count >= (i + 4)) {
-		*arg0 = idleasm_ett(st->token_int[i + 1]);
-		*arg1 = idleasm_ett(st->token_int[i + 3]);
+	if(st->token_count >= (i + 6)) {
+		*arg0 = idleasm_ett(st->tok[i + 1].t);
+		*arg1 = idleasm_ett(st->tok[i + 3].t);
+		*arg2 = idleasm_ett(st->tok[i + 5].t);
+	} else if(st->token_count >= (i + 4)) {
+		*arg0 = idleasm_ett(st->tok[i + 1].t);
+		*arg1 = idleasm_ett(st->tok[i + 3].t);
+		*arg2 = IDLEASM_TYPE_NULL;
 	} else if(st->token_count >= (i + 2)) {
-		*arg0 = idleasm_ett(st->token_int[i + 1]);
+		*arg0 = idleasm_ett(st->tok[i + 1].t);
 		*arg1 = IDLEASM_TYPE_NULL;
+		*arg2 = IDLEASM_TYPE_NULL;
 	} else {
 		*arg0 = IDLEASM_TYPE_NULL;
 		*arg1 = IDLEASM_TYPE_NULL;
+		*arg2 = IDLEASM_TYPE_NULL;
 	}
 	return 0;
 }
 
-int idleasm_push_label(lexstat_t *st, idleprm_t *prm, unsigned ln) {
-	if(idleasm_getopc(st) == 2) {
-		idleasm_build_label(prm, &st->token_matrix[0], ln);
-	}
-	return 0;
+int idleasm_tokint(lexstat_t *st, idleprm_t *prm, unsigned k, uint64_t *w, unsigned fk) {
+	/*
+		* an expression that names a later label becomes a fixup of kind FK
+		* on the slot about to be emitted, FK 0 where the value is needed now
+	*/
+	if(st->tok[k].t != IDLEASM_PARSER_EXPR) {return idleasm_intform(idleasm_tokp(st, k), st->tok[k].len, w);}
+	idleasm_tokpos(st, k);
+	if(!idleasm_expr(prm, idleasm_tokp(st, k), st->tok[k].len, w)) {return 1;}
+	if(!fk) {idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "label in expression must be defined before use here");}
+	idleasm_build_exprfix(prm, fk, idleasm_tokp(st, k), st->tok[k].len);
+	return 1;
 }
 
-int idleasm_findlabel(const char *name, idleprm_t *prm, uint32_t *n) {
-	unsigned sz = IDLEASM_LABELCOUNT * (prm->mlp - 1);
-	for(unsigned i = 0; i < sz; i++) {
-		if(!strcmp(name, prm->lbl[i].lb_name)) {
-			*n = prm->lbl[i].ln; return 1;
-		}
+int idleasm_iswide(lexstat_t *st, idleprm_t *prm) {
+	/*
+		* mov with a literal that does not fit into the zero-extended
+		* 32-bit imm is emitted as MOV_W followed by the 64-bit literal,
+		* umulh always takes the two-slot form
+	*/
+	unsigned oa = idleasm_getopc(st); int ta0, ta1, ta2; uint64_t w;
+	idleasm_getarg(st, &ta0, &ta1, &ta2);
+	if(ta0 != IDLEASM_TYPE_REG || ta1 != IDLEASM_TYPE_IMM || ta2 != IDLEASM_TYPE_NULL) {return 0;}
+	if(idleasm_streq(idleasm_tokp(st, oa), st->tok[oa].len, "umulh")) {return 1;}
+	if(!idleasm_streq(idleasm_tokp(st, oa), st->tok[oa].len, "mov")) {return 0;}
+	/* a label address fits into 32 bits, a pending one stays narrow */
+	if(st->tok[oa+3].t == IDLEASM_PARSER_EXPR) {
+		idleasm_tokpos(st, oa+3);
+		return !idleasm_expr(prm, idleasm_tokp(st, oa+3), st->tok[oa+3].len, &w) && w > UINT32_MAX;
 	}
-	return 0;
+	idleasm_intform(idleasm_tokp(st, oa+3), st->tok[oa+3].len, &w);
+	return w > UINT32_MAX;
 }
 
-int idleasm_findreg(const char *name, uint8_t *n) {
-	for(unsigned i = 0; i < arraysize(r); i++) {
-		if(!strcasecmp(name, r[i].mnemonic)) {
-			*n = r[i].r; return 1;
-		}
+int idleasm_push_label(lexstat_t *st, idleprm_t *prm) {
+	if(idleasm_getopc(st) == 2) {
+		idleasm_build_label(prm, idleasm_tokp(st, 0), st->tok[0].len, prm->isvd);
 	}
 	return 0;
 }
 
-int idleasm_findintr(const char *name, uint32_t *n) {
+int idleasm_findlabel(const char *name, unsigned l, idleprm_t *prm, uint32_t *n) {
+	labelstat_t *lb = *idleasm_lhtslot(prm, name, l, idleasm_hash(name, l, 0));
+	if(!lb || !lb->def) {return 0;}
+	*n = lb->ln;
+	return 1;
+}
+
+int idleasm_findreg(const char *name, unsigned l, uint8_t *n) {
+	int16_t x = rhash[idleasm_hash(name, l, rseed) & (IDLEASM_PHASHSIZE - 1)];
+	if(x < 0 || !idleasm_streq(name, l, r[x].mnemonic)) {return 0;}
+	*n = r[x].r;
+	return 1;
+}
+
+int idleasm_findintr(const char *name, unsigned l, uint32_t *n) {
 	for(unsigned i = 0; intr_name[i] != NULL; i++) {
-		if(!strcmp(name, intr_name[i])) {
+		if(strlen(intr_name[i]) == l && !memcmp(name, intr_name[i], l)) {
 			*n = i; return 1;
 		}
 	}
 	return 0;
 }
 
-unsigned idleasm_jmpissue(lexstat_t *st, idleprm_t *prm, uint32_t *n) {
-	unsigned l = (idleasm_getopc(st) + 1) * IDLEASM_TOKENSIZE;
-	int r = idleasm_findlabel(&st->token_matrix[l], prm, n);
+uint32_t idleasm_intnum(lexstat_t *st, idleprm_t *prm, unsigned k) {
+	/* a name that is not a built-in interrupt is a host import, numbered after them in order of first use */
+	const char *s = idleasm_tokp(st, k); unsigned l = st->tok[k].len; uint32_t n;
+	if(idleasm_findintr(s, l, &n)) {return n;}
+	for(labelstat_t *lb = prm->imp; lb; lb = lb->next) {
+		if(lb->len == l && !memcmp(lb->lb_name, s, l)) {return IDLEBIN_INTCOUNT + lb->idx;}
+	}
+	idleasm_tokpos(st, k);
+	if(idleasm_chunk) {idleasm_error(IDLEASM_ERR_SERIAL_ONLY, "host import in a parallel run");}
+	if(prm->defer) {idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "host import is not supported in an object file");}
+	labelstat_t *lb = idleasm_aalloc(&prm->ar, sizeof(labelstat_t));
+	lb->lb_name = s; lb->len = l; lb->idx = prm->nimp++;
+	lb->next = prm->imp; prm->imp = lb;
+	return IDLEBIN_INTCOUNT + lb->idx;
+}
+
+unsigned idleasm_jmpissue(lexstat_t *st, idleprm_t *prm, unsigned k, uint32_t *n) {
+	/*
+		* forward references are emitted as 0 and patched by idleasm_fixup,
+		* a chunk of a parallel run defers every reference to the merge
+	*/
+	int r = !prm->defer && idleasm_findlabel(idleasm_tokp(st, k), st->tok[k].len, prm, n);
+	if(!r) {
+		idleasm_tokpos(st, k);
+		idleasm_build_fixup(prm, idleasm_tokp(st, k), st->tok[k].len);
+		*n = 0; return r;
+	}
 	*n = (*n) - prm->isvd - 1;
 	return r;
 }
 
+int idleasm_patch(idleprm_t *prm, unsigned slot, size_t off, const void *p, size_t n) {
+	if(!prm->out) {memcpy((unsigned char *)&prm->svd[slot] + off, p, n); return 0;}
+	if(fseek(prm->out, (long)(slot * sizeof(opsvd_t) + off), SEEK_SET)) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	if(fwrite(p, n, 1, prm->out) != 1) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	return 0;
+}
+
+int idleasm_fixup(idleprm_t *prm) {
+	uint32_t n; uint64_t w;
+	for(unsigned a = 0; a < prm->ifix; a++) {
+		fixstat_t *f = &prm->fix[a];
+		if(f->kind != IDLEASM_FIX_REL) {
+			idleasm_pos = f->pos;
+			if(idleasm_expr(prm, f->lb->lb_name, f->lb->len, &w)) {idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "undefined label");}
+			n = (uint32_t)((int32_t)((int64_t)w));
+			if(f->kind == IDLEASM_FIX_DATA) {idleasm_patch(prm, f->slot, 0, &w, sizeof(uint64_t));}
+			else {idleasm_patch(prm, f->slot, offsetof(opsvd_t, imm), &n, sizeof(uint32_t));}
+			continue;
+		}
+		if(!f->lb->def) {idleasm_pos = f->pos; idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "undefined label");}
+		n = f->lb->ln - f->slot - 1;
+		idleasm_patch(prm, f->slot, offsetof(opsvd_t, imm), &n, sizeof(uint32_t));
+	}
+	idleasm_pos.line = 0;
+	if(prm->out) {fseek(prm->out, 0, SEEK_END);}
+	return 0;
+}
+
 int idleasm_push_instr(lexstat_t *st, idleprm_t *prm) {
-	unsigned oa = 0; int ta0 = 0, ta1 = 0;
+	unsigned oa = 0; int ta0 = 0, ta1 = 0, ta2 = 0;
 	uint8_t a0 = 0, a1 = 0; uint32_t imm = 0;
 	uint64_t tmp;
-	if(!strcmp(&st->token_matrix[IDLEASM_TOKENSIZE], ":\0") && st->token_count == 2) {idleasm_build_binary(prm, "nop\0", IDLEASM_TYPE_NULL, IDLEASM_TYPE_NULL, 0, 0, 0); return 0;}
+	if(idleasm_tokis(st, 1, ":") && st->token_count == 2) {
+		opsvd_t o = {NOP, 0, 0, 0};
+		return idleasm_emit(prm, &o, IDLEASM_SLOT_LABEL);
+	}
 	oa = idleasm_getopc(st);
-	idleasm_getarg(st, &ta0, &ta1);
-	if(!strcmp(&st->token_matrix[oa * IDLEASM_TOKENSIZE], "id\0") && (ta0 == IDLEASM_TYPE_IMM && ta1 == IDLEASM_TYPE_NULL)) {
-		idleasm_intform(&st->token_matrix[(oa+1) * IDLEASM_TOKENSIZE], &tmp);
+	idleasm_getarg(st, &ta0, &ta1, &ta2);
+	const char *op = idleasm_tokp(st, oa); unsigned ol = st->tok[oa].len;
+	if(idleasm_tokis(st, oa, "id") && (ta0 == IDLEASM_TYPE_IMM && ta1 == IDLEASM_TYPE_NULL)) {
+		idleasm_tokint(st, prm, oa+1, &tmp, IDLEASM_FIX_DATA);
+		idleasm_id_directive(prm, tmp);
+		return 0;
+	}
+	if(idleasm_tokis(st, oa, "global") && (ta0 == IDLEASM_TYPE_IDENT && ta1 == IDLEASM_TYPE_NULL)) {
+		/* exported from an object file, a plain binary ignores it */
+		idleasm_intern(prm, idleasm_tokp(st, oa+1), st->tok[oa+1].len)->glb = 1;
+		return 0;
+	}
+	if(idleasm_iswide(st, prm)) {
+		idleasm_findreg(idleasm_tokp(st, oa+1), st->tok[oa+1].len, &a0);
+		idleasm_build_binary(prm, op, ol, IDLEASM_TYPE_REG, IDLEASM_TYPE_WIMM, IDLEASM_TYPE_NULL, a0, 0, 0);
+		idleasm_tokint(st, prm, oa+3, &tmp, IDLEASM_FIX_DATA);
 		idleasm_id_directive(prm, tmp);
 		return 0;
 	}
-	if(ta0 == IDLEASM_TYPE_IDENT && !strcmp(&st->token_matrix[oa*IDLEASM_TOKENSIZE], "int\0")) {
-		idleasm_findintr(&st->token_matrix[(oa+1) * IDLEASM_TOKENSIZE], &imm);
+	if(ta0 == IDLEASM_TYPE_IDENT && idleasm_tokis(st, oa, "int")) {
+		imm = idleasm_intnum(st, prm, oa+1);
 		goto nj;
 	}
-	else if(ta1 == IDLEASM_TYPE_IDENT && !strcmp(&st->token_matrix[oa*IDLEASM_TOKENSIZE], "int\0")) {
-		idleasm_findintr(&st->token_matrix[(oa+3) * IDLEASM_TOKENSIZE], &imm);
+	else if(ta1 == IDLEASM_TYPE_IDENT && idleasm_tokis(st, oa, "int")) {
+		imm = idleasm_intnum(st, prm, oa+3);
 		goto nj;
 	} else {}
+	if(ta2 == IDLEASM_TYPE_IDENT) {
+		/* compare-and-branch: the branch offset takes imm, an immediate operand goes to arg1 */
+		idleasm_jmpissue(st, prm, oa+5, &imm);
+		if(ta1 == IDLEASM_TYPE_IMM) {
+			idleasm_tokint(st, prm, oa+3, &tmp, 0);
+			if(tmp > UINT8_MAX) {idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "compare-and-branch immediate does not fit into 8 bits");}
+			a1 = (uint8_t)tmp;
+		}
+		goto nr;
+	}
+	if(ta2 == IDLEASM_TYPE_IMM) {
+		/* stack load/store: base register in arg1, signed offset in imm */
+		idleasm_tokint(st, prm, oa+5, &tmp, IDLEASM_FIX_IMM);
+		if((int64_t)tmp != (int32_t)tmp) {idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "stack offset does not fit into 32 bits");}
+		imm = (uint32_t)tmp;
+		goto nr;
+	}
 	if(ta0 == IDLEASM_TYPE_IDENT) {
-		idleasm_jmpissue(st, prm, &imm);
+		idleasm_jmpissue(st, prm, oa+1, &imm);
 	}
 	else if(ta1 == IDLEASM_TYPE_IDENT) {
-		idleasm_jmpissue(st, prm, &imm);
+		idleasm_jmpissue(st, prm, oa+3, &imm);
 	} else {}
 	nj:
 	if(ta0 == IDLEASM_TYPE_IMM) {
-		idleasm_intform(&st->token_matrix[(oa+1) * IDLEASM_TOKENSIZE], &tmp);
+		idleasm_tokint(st, prm, oa+1, &tmp, IDLEASM_FIX_IMM);
 		imm = (uint32_t)((int32_t)((int64_t)tmp));
 	}
 	else if(ta1 == IDLEASM_TYPE_IMM) {
-		idleasm_intform(&st->token_matrix[(oa+3) * IDLEASM_TOKENSIZE], &tmp);
+		idleasm_tokint(st, prm, oa+3, &tmp, IDLEASM_FIX_IMM);
 		imm = (uint32_t)((int32_t)((int64_t)tmp));
 	} else {}
+	nr:
 	if(ta0 == IDLEASM_TYPE_FLOAT) {
 		idleasm_error(IDLEASM_ERR_FAILED_EXIT, "unreleased feature");
 	}
@@ -905,71 +1622,1514 @@ int idleasm_push_instr(lexstat_t *st, idleprm_t *prm) {
 		idleasm_error(IDLEASM_ERR_FAILED_EXIT, "unreleased feature");
 	}
 	if(ta0 == IDLEASM_TYPE_REG) {
-		idleasm_findreg(&st->token_matrix[(oa+1) * IDLEASM_TOKENSIZE], &a0);
+		idleasm_findreg(idleasm_tokp(st, oa+1), st->tok[oa+1].len, &a0);
 	}
 	if(ta1 == IDLEASM_TYPE_REG) {
-		idleasm_findreg(&st->token_matrix[(oa+3) * IDLEASM_TOKENSIZE], &a1);
+		idleasm_findreg(idleasm_tokp(st, oa+3), st->tok[oa+3].len, &a1);
+	}
+	if((idleasm_tokis(st, oa, "pushm") || idleasm_tokis(st, oa, "popm")) && a1 < a0) {
+		idleasm_tokpos(st, oa+3);
+		idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "register range is empty");
 	}
-	idleasm_build_binary(prm, &st->token_matrix[oa * IDLEASM_TOKENSIZE], ta0, ta1, a0, a1, imm);
+	idleasm_build_binary(prm, op, ol, ta0, ta1, ta2, a0, a1, imm);
 	return 0;
 }
 
-int idleasm_main(int argc, char **argv) {
-	if(argc < 3) {return 1;}
-
-	FILE *ff = fopen(argv[1], "r");
-	FILE *fo = fopen(argv[2], "wb");
+__extension__ typedef unsigned __int128 idleasm_u128;
 
-	if(fo == NULL || ff == NULL) {idleasm_error(IDLEASM_ERR_FILE_NOT_READ, "failed to read file");}
-
-	char buf[512];
+int idleasm_isbranch(uint16_t op) {
+	switch(op) {
+	case JMP: case JE: case JL: case JG: case JLE: case JGE: case JNE: case CALL: case TCALL: case LCALL:
+	case JE_R: case JE_I: case JL_R: case JL_I: case JG_R: case JG_I:
+	case JLE_R: case JLE_I: case JGE_R: case JGE_I: case JNE_R: case JNE_I: case LOOP:
+		return 1;
+	default:
+		return 0;
+	}
+}
 
-	lexstat_t *st = calloc(IDLEASM_STCOUNT, sizeof(lexstat_t)); idleprm_t prm; char table[256];
+int idleasm_ispow2(uint64_t a, unsigned *k) {
+	if(!a || (a & (a - 1))) {return 0;}
+	for(*k = 0; !(a & 1); a >>= 1) {(*k)++;}
+	return 1;
+}
 
-	idleasm_prmalloc(&prm);
+int idleasm_divmagic(uint64_t d, uint64_t *m, unsigned *s) {
+	/*
+		* n / d == umulh(n, m) >> s for every 64-bit n when m = ceil(2^(64+s) / d)
+		* fits into 64 bits and m*d - 2^(64+s) <= 2^s, otherwise keep the div
+	*/
+	for(unsigned k = 0; k < 64; k++) {
+		idleasm_u128 p = (idleasm_u128)1 << (64 + k);
+		idleasm_u128 q = (p + d - 1) / d;
+		if(q >> 64) {return 0;}
+		if(q * d - p <= ((idleasm_u128)1 << k)) {*m = (uint64_t)q; *s = k; return 1;}
+	}
+	return 0;
+}
 
-	idleasm_bintable_build("\r\v\t\n ", "()[]{},:;", "+*-/%^&|~", "\"\'`", table);
+unsigned idleasm_nextkept(const uint8_t *f, unsigned i, unsigned n) {
+	while(i < n && (f[i] & IDLEASM_SLOT_DEL)) {i++;}
+	return i;
+}
 
-	char *p;
+int idleasm_notarget(const uint8_t *tgt, unsigned i, unsigned j) {
+	for(unsigned k = i + 1; k <= j; k++) {
+		if(tgt[k]) {return 0;}
+	}
+	return 1;
+}
 
-	unsigned c;
+int idleasm_tailok(const opsvd_t *o, const uint8_t *f, unsigned n);
 
-	for(c = 0; c < IDLEASM_STCOUNT; c++) {
-		p = fgets(buf, 512, ff);
+int idleasm_peephole(idleprm_t *prm) {
+	/*
+		* FIXED = program indexes its own code through loadid or takes label
+		* addresses in expressions, slot numbers must not move
+		* DST = absolute branch target of every branch slot
+		* TGT = slot is the target of some branch
+		* MG, SH = multiply-high constant and shift for a div by constant
+		* TAIL = call + ret may become a tail call
+	*/
+	unsigned n = prm->isvd, fixed = prm->absref, ch = 1, k, pos = 0;
+	int tail = idleasm_tailok(prm->svd, prm->flg, n);
+	opsvd_t *o = prm->svd; uint8_t *f = prm->flg;
+	uint64_t *dst = idleasm_aalloc(&prm->ar, (n + 1)*sizeof(uint64_t));
+	uint64_t *mg = idleasm_aalloc(&prm->ar, (n + 1)*sizeof(uint64_t));
+	uint8_t *sh = idleasm_aalloc(&prm->ar, (n + 1)*sizeof(uint8_t));
+	uint8_t *tgt = idleasm_aalloc(&prm->ar, (n + 1)*sizeof(uint8_t));
+	unsigned *ni = idleasm_aalloc(&prm->ar, (n + 1)*sizeof(unsigned));
+
+	for(unsigned i = 0; i < n; i++) {
+		if(f[i] & IDLEASM_SLOT_DATA) {continue;}
+		if(o[i].op == INT && o[i].imm == IDLEBIN_INTLOADID) {fixed = 1;}
+		if(idleasm_isbranch(o[i].op)) {
+			int64_t t = (int64_t)i + (int32_t)o[i].imm + 1;
+			if(t < 0 || t > (int64_t)n) {fixed = 1; continue;}
+			dst[i] = (uint64_t)t; tgt[t] = 1;
+		}
+	}
 
-		idleasm_lexstat_alloc(&st[c]);
+	for(unsigned it = 0; ch && it < 16; it++) {
+		ch = 0;
+		for(unsigned i = 0; i < n; i++) {
+			if(f[i] & (IDLEASM_SLOT_DATA | IDLEASM_SLOT_DEL)) {continue;}
+			opsvd_t *a = &o[i];
+			unsigned j = idleasm_nextkept(f, i + 1, n);
+			opsvd_t *b = (j < n && !(f[j] & IDLEASM_SLOT_DATA)) ? &o[j] : NULL;
+			switch(a->op) {
+			case MUL_I: case IMUL_I:
+				if(a->imm == 0) {a->op = MOV_I; ch = 1;}
+				else if(a->imm == 1 && !fixed) {f[i] |= IDLEASM_SLOT_DEL; ch = 1;}
+				else if(idleasm_ispow2(a->imm, &k) && k) {a->op = SHL_I; a->imm = k; ch = 1;}
+				break;
+			case DIV_I:
+				if(a->imm == 1 && !fixed) {f[i] |= IDLEASM_SLOT_DEL; ch = 1;}
+				else if(idleasm_ispow2(a->imm, &k) && k) {a->op = SHR_I; a->imm = k; ch = 1;}
+				else if(a->imm > 1 && !fixed && !(f[i] & IDLEASM_SLOT_MAGIC) && idleasm_divmagic(a->imm, &mg[i], &k)) {
+					sh[i] = k; f[i] |= IDLEASM_SLOT_MAGIC;
+				}
+				break;
+			case MOD_I:
+				if(a->imm == 1) {a->op = MOV_I; a->imm = 0; ch = 1;}
+				else if(idleasm_ispow2(a->imm, &k) && k) {a->op = AND_I; a->imm -= 1; ch = 1;}
+				break;
+			case NOP:
+				if(!fixed) {f[i] |= IDLEASM_SLOT_DEL; ch = 1;}
+				break;
+			case PUSH: case POP: {
+				/* a run of push on ascending or pop on descending registers is one pushm/popm, never over sp */
+				unsigned e = i, c = a->arg0, m, up = a->op == PUSH;
+				if(fixed || c == 8) {break;}
+				for(m = j; m < n && !(f[m] & IDLEASM_SLOT_DATA) && o[m].op == a->op && o[m].arg0 != 8; m = idleasm_nextkept(f, m + 1, n)) {
+					if(o[m].arg0 != (up ? c + 1 : c - 1) || !idleasm_notarget(tgt, e, m)) {break;}
+					c = o[m].arg0; e = m;
+				}
+				if(e == i) {break;}
+				for(m = j; m <= e; m = idleasm_nextkept(f, m + 1, n)) {f[m] |= IDLEASM_SLOT_DEL;}
+				a->arg1 = up ? (uint8_t)c : a->arg0;
+				a->arg0 = up ? a->arg0 : (uint8_t)c;
+				a->op = up ? PUSHM : POPM; ch = 1;
+				break;
+			}
+			case CALL:
+				/* the callee returns straight to our caller, the ret is dead unless something jumps to it */
+				if(!tail || !b || b->op != RET) {break;}
+				a->op = TCALL; ch = 1;
+				if(!fixed && idleasm_notarget(tgt, i, j)) {f[j] |= IDLEASM_SLOT_DEL;}
+				break;
+			case MOV_R:
+				if(fixed) {break;}
+				if(a->arg0 == a->arg1) {f[i] |= IDLEASM_SLOT_DEL; ch = 1; break;}
+				if(b && b->op == MOV_R && b->arg0 == a->arg1 && b->arg1 == a->arg0 && idleasm_notarget(tgt, i, j)) {
+					f[j] |= IDLEASM_SLOT_DEL; ch = 1; break;
+				}
+				/* fall through */
+			case MOV_I:
+				if(fixed || !b || !idleasm_notarget(tgt, i, j - 1)) {break;}
+				if(((b->op == MOV_R && b->arg1 != a->arg0) || b->op == MOV_I || b->op == MOV_W) && b->arg0 == a->arg0) {
+					f[i] |= IDLEASM_SLOT_DEL; ch = 1;
+				}
+				break;
+			case CMP_R: case CMP_I:
+				if(fixed || !b || b->op < JE || b->op > JNE || !idleasm_notarget(tgt, i, j)) {break;}
+				if(a->op == CMP_I && a->imm > UINT8_MAX) {break;}
+				a->arg1 = a->op == CMP_I ? (uint8_t)a->imm : a->arg1;
+				a->op = JE_R + 2*(b->op - JE) + (a->op == CMP_I);
+				dst[i] = dst[j];
+				f[j] |= IDLEASM_SLOT_DEL; ch = 1;
+				break;
+			default:
+				break;
+			}
+		}
+		for(unsigned i = 0; i < n; i++) {
+			if(f[i] & (IDLEASM_SLOT_DATA | IDLEASM_SLOT_DEL) || !idleasm_isbranch(o[i].op)) {continue;}
+			/* thread jump-to-jump chains, the jmps passed on the way are pointed at the end too */
+			uint64_t d0 = dst[i]; unsigned h;
+			for(h = 0; h < n; h++) {
+				unsigned t = idleasm_nextkept(f, dst[i], n);
+				if(t >= n || t == i || o[t].op != JMP || (f[t] & IDLEASM_SLOT_DATA) || dst[t] == dst[i]) {break;}
+				dst[i] = dst[t]; ch = 1;
+			}
+			for(unsigned t = idleasm_nextkept(f, d0, n); h > 1; h--) {
+				unsigned u = idleasm_nextkept(f, dst[t], n);
+				dst[t] = dst[i]; t = u;
+			}
+			if(fixed || o[i].op < JMP || o[i].op > JNE) {continue;}
+			if(idleasm_nextkept(f, dst[i], n) == idleasm_nextkept(f, i + 1, n)) {f[i] |= IDLEASM_SLOT_DEL; ch = 1;}
+		}
+	}
 
-		idleasm_token(buf, table, &st[c]);
+	opsvd_t *out = idleasm_aalloc(&prm->ar, (2*n + 1)*sizeof(opsvd_t));
+	uint8_t *fo = idleasm_aalloc(&prm->ar, (2*n + 1)*sizeof(uint8_t));
+	for(unsigned i = 0; i < n; i++) {
+		ni[i] = pos;
+		if(f[i] & IDLEASM_SLOT_DEL) {continue;}
+		if(f[i] & IDLEASM_SLOT_MAGIC) {
+			out[pos].op = UMULH_W; out[pos].arg0 = o[i].arg0; pos++;
+			((uint64_t *)out)[pos] = mg[i]; fo[pos++] = IDLEASM_SLOT_DATA;
+			if(sh[i]) {out[pos].op = SHR_I; out[pos].arg0 = o[i].arg0; out[pos++].imm = sh[i];}
+			continue;
+		}
+		out[pos] = o[i]; fo[pos++] = f[i] & IDLEASM_SLOT_DATA;
+	}
+	ni[n] = pos;
+	for(unsigned i = 0; i < n; i++) {
+		if(f[i] & (IDLEASM_SLOT_DATA | IDLEASM_SLOT_DEL) || !idleasm_isbranch(o[i].op)) {continue;}
+		out[ni[i]].imm = (uint32_t)(int32_t)((int64_t)ni[dst[i]] - (int64_t)ni[i] - 1);
+	}
+	for(labelstat_t *lb = prm->lbl; lb; lb = lb->next) {
+		if(lb->def) {lb->ln = ni[lb->ln];}
+	}
+	if(prm->ncap) {
+		uint32_t *lo = idleasm_aalloc(&prm->ar, (pos + 1)*sizeof(uint32_t));
+		for(unsigned i = 0; i < n; i++) {
+			for(unsigned p = ni[i]; p < ni[i + 1]; p++) {lo[p] = prm->lin[i];}
+		}
+		prm->lin = lo; prm->ncap = pos + 1;
+	}
 
-		idleasm_enumerator(&st[c]);
+	prm->svd = out; prm->flg = fo; prm->isvd = pos;
+	return 0;
+}
 
-		idleasm_push_label(&st[c], &prm, c);
+int idleasm_zfits(uint32_t imm) {
+	return (int32_t)imm >= IDLEBIN_ZIMMMIN && (int32_t)imm <= IDLEBIN_ZIMMMAX;
+}
 
-		if(p == NULL) {break;}
+int idleasm_compact(idleprm_t *prm) {
+	/*
+		* --compact: the slots become compact words (idlebin.h), run last
+		* POS = word of every slot, the literal of a wide instruction goes
+		* to the pool with it and takes no word, ZP = the pool, entry 0 zero
+		* a program that indexes its own code or keeps data other than wide
+		* literals stays in slots, returns 1 when the words were made
+	*/
+	unsigned n = prm->isvd, p = 0, np = 1;
+	opsvd_t *o = prm->svd; uint8_t *f = prm->flg;
+	if(prm->absref) {return 0;}
+	unsigned *pos = idleasm_aalloc(&prm->ar, (n + 1)*sizeof(unsigned));
+
+	for(unsigned i = 0; i < n; i++) {
+		pos[i] = p;
+		if(f[i] & IDLEASM_SLOT_DATA) {
+			if(!i || (f[i - 1] & IDLEASM_SLOT_DATA) || (o[i - 1].op != MOV_W && o[i - 1].op != UMULH_W)) {return 0;}
+			continue;
+		}
+		if((o[i].op == INT && o[i].imm == IDLEBIN_INTLOADID) || o[i].op > 0xff || o[i].arg0 > IDLEBIN_ZREGMAX) {return 0;}
+		if((o[i].op == MOV_W || o[i].op == UMULH_W) && (i + 1 >= n || !(f[i + 1] & IDLEASM_SLOT_DATA))) {return 0;}
+		p++;
 	}
-
-	for(unsigned x = 0; x < c; x++) {
-		idleasm_push_instr(&st[x], &prm);
+	pos[n] = p;
+
+	/* one spare word, so the padding to a whole slot is already zero */
+	uint32_t *w = idleasm_aalloc(&prm->ar, (p + 1)*sizeof(uint32_t));
+	uint64_t *zp = idleasm_aalloc(&prm->ar, (p + 1)*sizeof(uint64_t));
+	for(unsigned i = 0; i < n; i++) {
+		if(f[i] & IDLEASM_SLOT_DATA) {continue;}
+		uint32_t imm = o[i].imm, *q = &w[pos[i]];
+		int wide = o[i].op == MOV_W || o[i].op == UMULH_W;
+		if(idleasm_isbranch(o[i].op)) {
+			int64_t t = (int64_t)i + (int32_t)imm + 1;
+			if(t < 0 || t > (int64_t)n || (t < n && (f[t] & IDLEASM_SLOT_DATA))) {return 0;}
+			imm = (uint32_t)(int32_t)((int64_t)pos[t] - pos[i] - 1);
+		}
+		*q = (uint32_t)o[i].op | (uint32_t)o[i].arg0 << 9;
+		/* the imm of ret and lret is never read, one that does not fit is dropped */
+		if(!wide && o[i].arg1 <= IDLEBIN_ZREGMAX && (idleasm_zfits(imm) || o[i].op == RET || o[i].op == LRET)) {
+			*q |= (uint32_t)o[i].arg1 << 15 | (idleasm_zfits(imm) ? imm << 21 : 0);
+			continue;
+		}
+		if(np > IDLEBIN_ZPOOLMAX) {return 0;}
+		if(wide) {memcpy(&zp[np], &o[i + 1], sizeof(uint64_t));} else {zp[np] = imm | (uint64_t)o[i].arg1 << 32;}
+		*q |= IDLEBIN_ZLONG | (uint32_t)np++ << 15;
 	}
-
-	for(unsigned x = 0; x < c; x++) {
-		fwrite(&prm.svd[x], sizeof(opsvd_t), 1, fo);
+	for(labelstat_t *lb = prm->lbl; lb; lb = lb->next) {
+		if(lb->def) {lb->ln = pos[lb->ln];}
 	}
-
-	idleasm_prmfree(&prm);
-
-	for(unsigned i = 0; i < c; i++) {
-		idleasm_lexstat_free(&st[i]);
+	if(prm->ncap) {
+		uint32_t *lo = idleasm_aalloc(&prm->ar, (p + 1)*sizeof(uint32_t));
+		for(unsigned i = 0; i < n; i++) {lo[pos[i]] = f[i] & IDLEASM_SLOT_DATA ? lo[pos[i]] : prm->lin[i];}
+		prm->lin = lo; prm->ncap = p + 1;
 	}
 
-	free(st);
-
-	return 0;
+	prm->zw = w; prm->zp = zp; prm->nzp = np; prm->isvd = p; prm->zip = 1;
+	return 1;
 }
 
-int main(int argc, char **argv) {
-	idleasm_main(argc, argv);
-
+/*
+	* -O2: dataflow over the whole program, run before the peephole pass
+	* blocks are split at branch targets and after control transfers, CALL
+	* jumps to its target and RET flows to every return site, so a callee
+	* is analysed with the states of all of its callers, the VM starts with
+	* every register 0
+*/
+
+#define IDLEASM_DF_NONE UINT32_MAX
+#define IDLEASM_DF_PURE 0x01
+#define IDLEASM_DF_FOLD 0x02
+#define IDLEASM_DF_BAD 0x04
+
+#define IDLEASM_DFR(x) ((x) < 64 ? (uint64_t)1 << (x) : 0)
+
+typedef struct dfblk_t {
+	/*
+		* slots [B, E), S0 = fall-through or jump target, S1 = taken edge of a
+		* conditional branch, RET = successors are the return sites, RS =
+		* return site of a CALL that ends the block, FD = falls into data
+	*/
+	unsigned b;
+	unsigned e;
+	unsigned s0;
+	unsigned s1;
+	unsigned rs;
+	uint8_t ret;
+	uint8_t fd;
+	uint8_t reach;
+	uint8_t inq;
+	uint64_t lin;
+	uint64_t lout;
+} dfblk_t;
+
+typedef struct dfstat_t {
+	/* KN = registers with known value V, CP = register this one copies, CM = registers with a CP */
+	uint64_t kn;
+	uint64_t cm;
+	uint64_t v[64];
+	uint8_t cp[64];
+} dfstat_t;
+
+typedef struct dfprm_t {
+	/*
+		* KIND = 0 instruction, 1 literal of a wide form, 2 data
+		* BI = block of a slot, RS = return sites of reachable calls
+		* KB = outcome of a fused compare-and-branch, 1 taken, 2 not taken
+		* RL = dense index of each of the NR registers in UM, per block
+		* states SKN (known and copy masks), SV, SCP are kept for those only
+	*/
+	opsvd_t *o;
+	uint8_t *f;
+	unsigned n;
+	uint8_t *kind;
+	unsigned *bi;
+	dfblk_t *blk;
+	unsigned nb;
+	unsigned *rs;
+	unsigned nrs;
+	uint8_t *kb;
+	uint64_t um;
+	uint8_t rl[64];
+	unsigned nr;
+	uint64_t *skn;
+	uint64_t *sv;
+	uint8_t *scp;
+	uint8_t *vis;
+} dfprm_t;
+
+void *idleasm_dfalloc(size_t n) {
+	void *p = calloc(n ? n : 1, 1);
+	if(!p) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "allocation failed");}
+	return p;
+}
+
+int idleasm_dfpair(uint16_t op) {
+	/* register forms whose imm form is the next opcode */
+	switch(op) {
+	case ADD_R: case SUB_R: case RSB_R: case MUL_R: case DIV_R: case RDV_R: case MOD_R: case RMD_R:
+	case IMUL_R: case IDIV_R: case IRDV_R: case AND_R: case OR_R: case XOR_R: case SHR_R: case SHL_R:
+	case MOV_R: case CMP_R: case ASR_R: case BT_R: case BTS_R: case BTR_R: case BTI_R:
+	case LDB_R: case LDDB_R: case LDQB_R: case STB_R: case STDB_R: case STQB_R:
+	case JE_R: case JL_R: case JG_R: case JLE_R: case JGE_R: case JNE_R:
+	case CMOVE_R: case CMOVL_R: case CMOVG_R: case CMOVLE_R: case CMOVGE_R: case CMOVNE_R:
+	case MIN_R: case MAX_R: case IMIN_R: case IMAX_R: case ROL_R: case ROR_R:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+uint64_t idleasm_dfmask(uint16_t cc) {
+	/* atr0 bits of the conditions e, l, g, le, ge, ne in opcode order */
+	static const uint8_t m[6] = {0x01, 0x04, 0x02, 0x05, 0x03, 0x06};
+	return m[cc % 6];
+}
+
+uint64_t idleasm_dfrange(unsigned a, unsigned b) {
+	/* registers a..b of pushm/popm, none when the range is empty */
+	if(a > b || b >= 64) {return 0;}
+	return (~(uint64_t)0 >> (63 - b)) & (~(uint64_t)0 << a);
+}
+
+unsigned idleasm_dfuse(const opsvd_t *o, uint64_t *use, uint64_t *def) {
+	/*
+		* registers read and written by O, PURE when it has no effect besides
+		* DEF, FOLD when a known result may replace it, BAD for an opcode or
+		* register number the analysis does not know
+		* loads are not PURE: like a division they can stop the program, an
+		* address outside guest memory or an lds past the stack traps
+	*/
+	uint64_t a = IDLEASM_DFR(o->arg0), b = IDLEASM_DFR(o->arg1), x = IDLEASM_DFR(0);
+	unsigned fl = 0, ar = 0;
+	*use = 0; *def = 0;
+	switch(o->op) {
+	case ADD_R: case SUB_R: case RSB_R: case MUL_R: case IMUL_R: case AND_R: case OR_R: case XOR_R:
+	case SHR_R: case SHL_R: case ASR_R: case BT_R: case BTS_R: case BTR_R: case BTI_R:
+	case MIN_R: case MAX_R: case IMIN_R: case IMAX_R: case ROL_R: case ROR_R: case CRC32: case UMULH_R:
+		ar = 3; *use = a | b; *def = a; fl = IDLEASM_DF_PURE | IDLEASM_DF_FOLD; break;
+	case DIV_R: case RDV_R: case MOD_R: case RMD_R: case IDIV_R: case IRDV_R:
+		ar = 3; *use = a | b; *def = a; fl = IDLEASM_DF_FOLD; break;
+	case DIV_I: case MOD_I: case IDIV_I:
+		ar = 1; *use = a; *def = a; fl = IDLEASM_DF_FOLD | (o->imm ? IDLEASM_DF_PURE : 0); break;
+	case RDV_I: case RMD_I: case IRDV_I:
+		ar = 1; *use = a; *def = a; fl = IDLEASM_DF_FOLD; break;
+	case ADD_I: case SUB_I: case RSB_I: case MUL_I: case IMUL_I: case AND_I: case OR_I: case XOR_I:
+	case SHR_I: case SHL_I: case ASR_I: case BT_I: case BTS_I: case BTR_I: case BTI_I:
+	case MIN_I: case MAX_I: case IMIN_I: case IMAX_I: case ROL_I: case ROR_I: case UMULH_W:
+	case NOT_R: case BSWAP:
+		ar = 1; *use = a; *def = a; fl = IDLEASM_DF_PURE | IDLEASM_DF_FOLD; break;
+	case MOV_R: case POPCNT: case LZCNT: case TZCNT:
+		ar = 3; *use = b; *def = a; fl = IDLEASM_DF_PURE | IDLEASM_DF_FOLD; break;
+	case MOV_I: case MOV_W:
+		ar = 1; *def = a; fl = IDLEASM_DF_PURE | IDLEASM_DF_FOLD; break;
+	case LDB_R: case LDDB_R: case LDQB_R:
+		ar = 3; *use = b; *def = a; break;
+	case LDB_I: case LDDB_I: case LDQB_I:
+		ar = 1; *def = a; break;
+	case STB_R: case STDB_R: case STQB_R:
+		ar = 3; *use = a | b; break;
+	case STB_I: case STDB_I: case STQB_I:
+		ar = 1; *use = a; break;
+	case XCHG:
+		ar = 3; *use = a | b; *def = a | b; fl = IDLEASM_DF_PURE; break;
+	case CMP_R:
+		ar = 3; *use = a | b; *def = x; fl = IDLEASM_DF_PURE; break;
+	case CMP_I:
+		ar = 1; *use = a; *def = x; fl = IDLEASM_DF_PURE; break;
+	case CMOVE_R: case CMOVL_R: case CMOVG_R: case CMOVLE_R: case CMOVGE_R: case CMOVNE_R:
+		ar = 3; *use = a | b | x; *def = a; fl = IDLEASM_DF_PURE | IDLEASM_DF_FOLD; break;
+	case CMOVE_I: case CMOVL_I: case CMOVG_I: case CMOVLE_I: case CMOVGE_I: case CMOVNE_I:
+		ar = 1; *use = a | x; *def = a; fl = IDLEASM_DF_PURE | IDLEASM_DF_FOLD; break;
+	case SETE: case SETL: case SETG: case SETLE: case SETGE: case SETNE:
+		ar = 1; *use = x; *def = a; fl = IDLEASM_DF_PURE | IDLEASM_DF_FOLD; break;
+	case JE: case JL: case JG: case JLE: case JGE: case JNE:
+		*use = x; break;
+	case JE_R: case JL_R: case JG_R: case JLE_R: case JGE_R: case JNE_R:
+		ar = 3; *use = a | b; *def = x; break;
+	case JE_I: case JL_I: case JG_I: case JLE_I: case JGE_I: case JNE_I:
+		ar = 1; *use = a; *def = x; break;
+	case LOOP:
+		ar = 1; *use = a; *def = a; break;
+	case PUSH:
+		ar = 1; *use = a | IDLEASM_DFR(8); *def = IDLEASM_DFR(8); break;
+	case POP:
+		ar = 1; *use = IDLEASM_DFR(8); *def = a | IDLEASM_DFR(8); break;
+	case CALL: case RET:
+		*use = IDLEASM_DFR(3); *def = IDLEASM_DFR(3); break;
+	case LCALL:
+		*def = IDLEASM_DFR(9); break;
+	case LRET:
+		*use = IDLEASM_DFR(9); break;
+	case ENTER: case LEAVE:
+		*use = IDLEASM_DFR(8) | IDLEASM_DFR(10); *def = IDLEASM_DFR(8) | IDLEASM_DFR(10); break;
+	case PUSHM:
+		ar = 3; *use = idleasm_dfrange(o->arg0, o->arg1) | IDLEASM_DFR(8); *def = IDLEASM_DFR(8); break;
+	case POPM:
+		ar = 3; *use = IDLEASM_DFR(8); *def = idleasm_dfrange(o->arg0, o->arg1) | IDLEASM_DFR(8); break;
+	case LDS:
+		ar = 3; *use = b; *def = a; break;
+	case STS:
+		ar = 3; *use = a | b; break;
+	case HLT: case NOP: case JMP: case TCALL:
+		break;
+	case INT:
+		/*
+			* exit abort readc writec loadsd loadad loadid writes reads writen readn
+			* mapf mapinfo, readn may leave rtv, a host import may touch any register
+		*/
+		switch(o->imm) {
+		case 0: case 3: case 7: case 9: *use = IDLEASM_DFR(4); break;
+		case 1: break;
+		case 2: *def = IDLEASM_DFR(2); break;
+		case 4: case 5: *use = IDLEASM_DFR(4); *def = IDLEASM_DFR(2); break;
+		case 8: *use = IDLEASM_DFR(4) | IDLEASM_DFR(5); break;
+		case 10: *use = IDLEASM_DFR(2); *def = IDLEASM_DFR(2); break;
+		case 11: *use = IDLEASM_DFR(4) | IDLEASM_DFR(5); *def = IDLEASM_DFR(2); break;
+		case 12: *use = IDLEASM_DFR(4); *def = IDLEASM_DFR(2) | IDLEASM_DFR(5); break;
+		default: *use = ~(uint64_t)0; *def = ~(uint64_t)0; break;
+		}
+		break;
+	default:
+		fl = IDLEASM_DF_BAD; break;
+	}
+	if(((ar & 1) && o->arg0 >= 64) || ((ar & 2) && o->arg1 >= 64)) {fl |= IDLEASM_DF_BAD;}
+	return fl;
+}
+
+int idleasm_tailok(const opsvd_t *o, const uint8_t *f, unsigned n) {
+	/* a tail call leaves rta one lower, so not when the program looks at rta or the return stack itself */
+	uint64_t use, def;
+	for(unsigned i = 0; i < n; i++) {
+		if((f[i] & IDLEASM_SLOT_DATA) || o[i].op == CALL || o[i].op == RET) {continue;}
+		if(o[i].op == INT && o[i].imm == 5) {return 0;}
+		if((idleasm_dfuse(&o[i], &use, &def) & IDLEASM_DF_BAD) || ((use | def) & IDLEASM_DFR(3))) {return 0;}
+	}
+	return 1;
+}
+
+int idleasm_dfalu(uint16_t op, uint64_t x, uint64_t y, uint64_t *r) {
+	/* value of the register form OP on X and Y exactly as the VM computes it, 0 when it traps or is undefined */
+	switch(op) {
+	case ADD_R: *r = x + y; return 1;
+	case SUB_R: *r = x - y; return 1;
+	case RSB_R: *r = y - x; return 1;
+	case MUL_R: case IMUL_R: *r = x * y; return 1;
+	case DIV_R: if(!y) {return 0;} *r = x / y; return 1;
+	case RDV_R: if(!x) {return 0;} *r = y / x; return 1;
+	case MOD_R: if(!y) {return 0;} *r = x % y; return 1;
+	case RMD_R: if(!x) {return 0;} *r = y % x; return 1;
+	case IDIV_R:
+		if(!y || (x == (UINT64_C(1) << 63) && y == UINT64_MAX)) {return 0;}
+		*r = (uint64_t)((int64_t)x / (int64_t)y); return 1;
+	case IRDV_R:
+		if(!x || (y == (UINT64_C(1) << 63) && x == UINT64_MAX)) {return 0;}
+		*r = (uint64_t)((int64_t)y / (int64_t)x); return 1;
+	case AND_R: *r = x & y; return 1;
+	case OR_R: *r = x | y; return 1;
+	case XOR_R: *r = x ^ y; return 1;
+	case SHR_R: if(y > 63) {return 0;} *r = x >> y; return 1;
+	case SHL_R: if(y > 63) {return 0;} *r = x << y; return 1;
+	case ASR_R: if(y > 63) {return 0;} *r = (uint64_t)((int64_t)x >> y); return 1;
+	case BT_R: *r = (x >> (y & 0x3f)) & 1; return 1;
+	case MIN_R: *r = y < x ? y : x; return 1;
+	case MAX_R: *r = y > x ? y : x; return 1;
+	case IMIN_R: *r = (int64_t)y < (int64_t)x ? y : x; return 1;
+	case IMAX_R: *r = (int64_t)y > (int64_t)x ? y : x; return 1;
+	case ROL_R: *r = (x << (y & 0x3f)) | (x >> (-y & 0x3f)); return 1;
+	case ROR_R: *r = (x >> (y & 0x3f)) | (x << (-y & 0x3f)); return 1;
+	case UMULH_R: *r = (uint64_t)(((idleasm_u128)x * y) >> 64); return 1;
+	default: return 0;
+	}
+}
+
+int idleasm_dfval(dfprm_t *d, const dfstat_t *s, unsigned i, uint64_t *r) {
+	/* known value written to arg0 by a FOLD instruction */
+	const opsvd_t *o = &d->o[i]; unsigned a = o->arg0 & 0x3f, b = o->arg1 & 0x3f;
+	uint16_t op = o->op, rf = op && idleasm_dfpair(op - 1);
+	uint64_t x = s->v[a], y = rf ? o->imm : s->v[b], lit = i + 1 < d->n ? ((uint64_t *)d->o)[i + 1] : 0;
+	int kx = (s->kn >> a) & 1, ky = rf || ((s->kn >> b) & 1), kf = s->kn & 1;
+	if(rf) {op--;}
+	switch(op) {
+	case MOV_R: *r = y; return ky;
+	case MOV_W: *r = lit; return 1;
+	case UMULH_W: *r = (uint64_t)(((idleasm_u128)x * lit) >> 64); return kx;
+	case NOT_R: *r = ~x; return kx;
+	case BSWAP: *r = __builtin_bswap64(x); return kx;
+	case SETE: case SETL: case SETG: case SETLE: case SETGE: case SETNE:
+		*r = !!(s->v[0] & idleasm_dfmask(op - SETE)); return kf;
+	case CMOVE_R: case CMOVL_R: case CMOVG_R: case CMOVLE_R: case CMOVGE_R: case CMOVNE_R:
+		if(kf) {int c = !!(s->v[0] & idleasm_dfmask((op - CMOVE_R) / 2)); *r = c ? y : x; return c ? ky : kx;}
+		*r = x; return kx && ky && x == y;
+	case XOR_R: case SUB_R:
+		if(!rf && a == b) {*r = 0; return 1;}
+		return kx && ky && idleasm_dfalu(op, x, y, r);
+	default:
+		return kx && ky && idleasm_dfalu(op, x, y, r);
+	}
+}
+
+uint64_t idleasm_dfcmp(uint64_t x, uint64_t y) {
+	/* atr0 after cmp */
+	return x > y ? 0x2 : (x < y ? 0x4 : 0x1);
+}
+
+void idleasm_dfkill(dfstat_t *s, uint64_t def) {
+	/* registers in DEF lose their value, their copies and the copies of them */
+	for(uint64_t m = s->cm; m; m &= m - 1) {
+		unsigned r = (unsigned)__builtin_ctzll(m);
+		if(((def >> r) & 1) || ((def >> s->cp[r]) & 1)) {s->cp[r] = 0xff; s->cm &= ~((uint64_t)1 << r);}
+	}
+	s->kn &= ~def;
+}
+
+void idleasm_dfset(dfstat_t *s, unsigned r, int k, uint64_t v) {
+	if(k) {s->kn |= (uint64_t)1 << r; s->v[r] = v;}
+}
+
+int idleasm_dfrewrite(dfprm_t *d, dfstat_t *s, unsigned i) {
+	/*
+		* rewrites slot I with what is known before it: copies are read from
+		* their source, known register operands become imm operands, decided
+		* branches and cmovs become jmp, mov or nothing, and a known result
+		* that fits the zero-extended imm becomes mov_i
+	*/
+	opsvd_t *o = &d->o[i]; uint64_t use, def, r; unsigned ch = 0, fl;
+	uint16_t op = o->op;
+	unsigned src = 0;
+	switch(op) {
+	case CMP_R: case STB_R: case STDB_R: case STQB_R:
+	case JE_R: case JL_R: case JG_R: case JLE_R: case JGE_R: case JNE_R:
+		src = 3; break;
+	case CMP_I: case STB_I: case STDB_I: case STQB_I: case PUSH:
+	case JE_I: case JL_I: case JG_I: case JLE_I: case JGE_I: case JNE_I:
+		src = 1; break;
+	case XCHG: case POP:
+		break;
+	default:
+		fl = idleasm_dfuse(o, &use, &def);
+		if(use & IDLEASM_DFR(o->arg1) & ~IDLEASM_DFR(0) && !(def & IDLEASM_DFR(o->arg1)) && op != INT) {src = 2;}
+		break;
+	}
+	if((src & 2) && s->cp[o->arg1] != 0xff) {o->arg1 = s->cp[o->arg1]; ch = 1;}
+	if((src & 1) && s->cp[o->arg0] != 0xff) {o->arg0 = s->cp[o->arg0]; ch = 1;}
+
+	if(idleasm_dfpair(op) && ((s->kn >> o->arg1) & 1)) {
+		uint64_t c = s->v[o->arg1];
+		if(op >= JE_R && op <= JNE_I) {
+			if(c <= UINT8_MAX) {o->op = op + 1; o->arg1 = (uint8_t)c; ch = 1;}
+		} else if(c <= UINT32_MAX) {
+			o->op = op + 1; o->arg1 = 0; o->imm = (uint32_t)c; ch = 1;
+		}
+		op = o->op;
+	}
+
+	if(op >= JE && op <= JNE && (s->kn & 1)) {
+		if(s->v[0] & idleasm_dfmask(op - JE)) {d->f[i] |= IDLEASM_SLOT_DEL;} else {o->op = JMP;}
+		return 1;
+	}
+	if(op >= JE_R && op <= JNE_I) {
+		unsigned a = o->arg0, b = o->arg1; uint64_t y = (op - JE_R) % 2 ? b : s->v[b];
+		if(((s->kn >> a) & 1) && ((op - JE_R) % 2 || ((s->kn >> b) & 1))) {
+			d->kb[i] = (idleasm_dfcmp(s->v[a], y) & idleasm_dfmask((op - JE_R) / 2)) ? 2 : 1;
+		}
+		return ch;
+	}
+	if(op >= CMOVE_R && op <= CMOVNE_I && (s->kn & 1)) {
+		if(!(s->v[0] & idleasm_dfmask((op - CMOVE_R) / 2))) {d->f[i] |= IDLEASM_SLOT_DEL; return 1;}
+		o->op = (op - CMOVE_R) % 2 ? MOV_I : MOV_R;
+		op = o->op; ch = 1;
+	}
+
+	fl = idleasm_dfuse(o, &use, &def);
+	if((fl & IDLEASM_DF_FOLD) && op != MOV_I && idleasm_dfval(d, s, i, &r) && r <= UINT32_MAX) {
+		if(op == MOV_W || op == UMULH_W) {d->f[i + 1] |= IDLEASM_SLOT_DEL;}
+		o->op = MOV_I; o->arg1 = 0; o->imm = (uint32_t)r;
+		ch = 1;
+	}
+	return ch;
+}
+
+int idleasm_dfstep(dfprm_t *d, dfstat_t *s, unsigned i, int rw) {
+	/* moves the state S over slot I, with RW the slot is rewritten first */
+	int ch = 0;
+	if(d->kind[i] || (d->f[i] & IDLEASM_SLOT_DEL)) {return 0;}
+	if(rw) {ch = idleasm_dfrewrite(d, s, i);}
+	if(d->f[i] & IDLEASM_SLOT_DEL) {return ch;}
+
+	opsvd_t *o = &d->o[i]; uint64_t use, def, r = 0, x, y;
+	unsigned fl = idleasm_dfuse(o, &use, &def), a = o->arg0 & 0x3f, b = o->arg1 & 0x3f;
+	int k = 0, kx = (s->kn >> a) & 1, ky = (s->kn >> b) & 1;
+	uint16_t op = o->op;
+	x = s->v[a]; y = s->v[b];
+	if(fl & IDLEASM_DF_FOLD) {k = idleasm_dfval(d, s, i, &r);}
+
+	switch(op) {
+	case CMP_R: case CMP_I:
+	case JE_R: case JE_I: case JL_R: case JL_I: case JG_R: case JG_I:
+	case JLE_R: case JLE_I: case JGE_R: case JGE_I: case JNE_R: case JNE_I:
+		if(op == CMP_I) {y = o->imm; ky = 1;}
+		else if(op >= JE_R && (op - JE_R) % 2) {y = o->arg1; ky = 1;}
+		idleasm_dfkill(s, def);
+		idleasm_dfset(s, 0, kx && ky, idleasm_dfcmp(x, y));
+		return ch;
+	case XCHG:
+		idleasm_dfkill(s, def);
+		idleasm_dfset(s, a, ky, y);
+		idleasm_dfset(s, b, kx, x);
+		return ch;
+	case LOOP:
+		idleasm_dfkill(s, def);
+		idleasm_dfset(s, a, kx, x - 1);
+		return ch;
+	case PUSH: case POP: case CALL: case RET:
+		x = s->v[op == CALL || op == RET ? 3 : 8];
+		kx = (s->kn >> (op == CALL || op == RET ? 3 : 8)) & 1;
+		idleasm_dfkill(s, def);
+		idleasm_dfset(s, op == CALL || op == RET ? 3 : 8, kx, op == PUSH || op == CALL ? x + 1 : x - 1);
+		if(op == POP) {idleasm_dfkill(s, IDLEASM_DFR(a));}
+		return ch;
+	default:
+		break;
+	}
+	idleasm_dfkill(s, def);
+	if(fl & IDLEASM_DF_FOLD) {idleasm_dfset(s, a, k, r);}
+	if(op == MOV_R && a != b) {
+		s->cp[a] = s->cp[b] != 0xff ? s->cp[b] : (uint8_t)b;
+		s->cm |= (uint64_t)1 << a;
+	}
+	return ch;
+}
+
+void idleasm_dfload(dfprm_t *d, unsigned bk, dfstat_t *s) {
+	s->kn = d->skn[2*bk]; s->cm = d->skn[2*bk + 1];
+	for(uint64_t m = d->um; m; m &= m - 1) {
+		unsigned r = (unsigned)__builtin_ctzll(m);
+		s->v[r] = d->sv[(size_t)bk*d->nr + d->rl[r]];
+		s->cp[r] = d->scp[(size_t)bk*d->nr + d->rl[r]];
+	}
+}
+
+int idleasm_dfmeet(dfprm_t *d, unsigned bk, const dfstat_t *s) {
+	/* joins S into the entry state of block BK, 1 when it changed */
+	uint64_t *v = &d->sv[(size_t)bk*d->nr]; uint8_t *cp = &d->scp[(size_t)bk*d->nr];
+	if(!d->vis[bk]) {
+		d->vis[bk] = 1;
+		d->skn[2*bk] = s->kn; d->skn[2*bk + 1] = s->cm;
+		for(uint64_t m = d->um; m; m &= m - 1) {
+			unsigned r = (unsigned)__builtin_ctzll(m);
+			v[d->rl[r]] = s->v[r]; cp[d->rl[r]] = s->cp[r];
+		}
+		return 1;
+	}
+	uint64_t kn = d->skn[2*bk] & s->kn, cm = d->skn[2*bk + 1];
+	for(uint64_t m = kn; m; m &= m - 1) {
+		unsigned r = (unsigned)__builtin_ctzll(m);
+		if(v[d->rl[r]] != s->v[r]) {kn &= ~((uint64_t)1 << r);}
+	}
+	for(uint64_t m = cm; m; m &= m - 1) {
+		unsigned r = (unsigned)__builtin_ctzll(m);
+		if(cp[d->rl[r]] != s->cp[r]) {cp[d->rl[r]] = 0xff; cm &= ~((uint64_t)1 << r);}
+	}
+	if(kn == d->skn[2*bk] && cm == d->skn[2*bk + 1]) {return 0;}
+	d->skn[2*bk] = kn; d->skn[2*bk + 1] = cm;
+	return 1;
+}
+
+int idleasm_dfterm(const opsvd_t *o) {
+	/* 1 jump, 2 conditional, 3 call, 4 ret, 5 stop */
+	switch(o->op) {
+	case JMP: case TCALL: return 1;
+	case JE: case JL: case JG: case JLE: case JGE: case JNE: case LOOP:
+	case JE_R: case JE_I: case JL_R: case JL_I: case JG_R: case JG_I:
+	case JLE_R: case JLE_I: case JGE_R: case JGE_I: case JNE_R: case JNE_I:
+		return 2;
+	case CALL: case LCALL: return 3;
+	case RET: case LRET: return 4;
+	case HLT: return 5;
+	case INT: return o->imm <= 1 ? 5 : 0;
+	default: return 0;
+	}
+}
+
+int idleasm_dfcfg(dfprm_t *d) {
+	/* splits the slots into blocks and finds the reachable ones, 0 when the program is out of reach of the model */
+	unsigned n = d->n, nb = 0; opsvd_t *o = d->o; uint8_t *f = d->f;
+	uint8_t *lead = idleasm_dfalloc(n + 1);
+	uint64_t use, def;
+
+	d->um = 0;
+	for(unsigned i = 0; i < n; i++) {
+		if(f[i] & IDLEASM_SLOT_DATA) {
+			d->kind[i] = i && !d->kind[i - 1] && (o[i - 1].op == MOV_W || o[i - 1].op == UMULH_W) ? 1 : 2;
+			if(d->kind[i] == 2) {lead[i + 1] = 1;}
+			continue;
+		}
+		d->kind[i] = 0;
+		if((o[i].op == MOV_W || o[i].op == UMULH_W) && (i + 1 >= n || !(f[i + 1] & IDLEASM_SLOT_DATA))) {free(lead); return 0;}
+		if(f[i] & IDLEASM_SLOT_DEL) {continue;}
+		if(idleasm_dfuse(&o[i], &use, &def) & IDLEASM_DF_BAD) {free(lead); return 0;}
+		d->um |= use | def;
+		unsigned t = idleasm_dfterm(&o[i]);
+		if(t) {lead[i + 1] = 1;}
+		if(t >= 1 && t <= 3) {
+			int64_t g = (int64_t)i + (int32_t)o[i].imm + 1;
+			if(g < 0 || g > (int64_t)n) {free(lead); return 0;}
+			lead[g] |= 2;
+		}
+	}
+	if(!n || d->kind[0]) {free(lead); return 0;}
+	lead[0] = 1;
+
+	for(unsigned i = 0; i < n; i++) {
+		if((lead[i] & 2) && d->kind[i]) {free(lead); return 0;}
+		if(d->kind[i] == 2) {d->bi[i] = IDLEASM_DF_NONE; continue;}
+		if(lead[i] || d->kind[i - 1] == 2) {d->blk[nb].b = i; nb++;}
+		d->bi[i] = nb - 1;
+		d->blk[nb - 1].e = i + 1;
+	}
+	free(lead);
+	d->nb = nb;
+
+	for(unsigned k = 0; k < nb; k++) {
+		dfblk_t *bk = &d->blk[k]; unsigned l = IDLEASM_DF_NONE, t = 0;
+		for(unsigned i = bk->b; i < bk->e; i++) {
+			if(!d->kind[i] && !(f[i] & IDLEASM_SLOT_DEL)) {l = i;}
+		}
+		bk->s0 = bk->s1 = bk->rs = IDLEASM_DF_NONE;
+		bk->ret = bk->fd = bk->reach = bk->inq = 0;
+		bk->lin = bk->lout = 0;
+		unsigned fall = bk->e < n ? d->bi[bk->e] : IDLEASM_DF_NONE;
+		if(bk->e < n && d->kind[bk->e] == 2) {bk->fd = 1;}
+		if(l != IDLEASM_DF_NONE) {t = idleasm_dfterm(&o[l]);}
+		if(t >= 1 && t <= 3) {
+			unsigned g = (unsigned)((int64_t)l + (int32_t)o[l].imm + 1);
+			unsigned tb = g < n ? d->bi[g] : IDLEASM_DF_NONE;
+			if(t == 1) {bk->s0 = tb; bk->fd = 0;}
+			if(t == 2) {bk->s0 = fall; bk->s1 = tb;}
+			if(t == 3) {bk->s0 = tb; bk->rs = fall;}
+		} else if(t == 4) {
+			bk->ret = 1; bk->fd = 0;
+		} else if(t == 5) {
+			bk->fd = 0;
+		} else {
+			bk->s0 = fall;
+		}
+	}
+
+	/* reachability, a return site is reached once its call and some ret are */
+	unsigned *st = idleasm_dfalloc((size_t)(nb + 1)*sizeof(unsigned)), sp = 0, anyret = 0;
+	d->nrs = 0;
+	d->blk[0].reach = 1; st[sp++] = 0;
+	while(sp) {
+		dfblk_t *bk = &d->blk[st[--sp]];
+		unsigned nx[3] = {bk->s0, bk->s1, IDLEASM_DF_NONE};
+		if(bk->fd) {free(st); return 0;}
+		if(bk->rs != IDLEASM_DF_NONE) {
+			d->rs[d->nrs++] = bk->rs;
+			if(anyret) {nx[2] = bk->rs;}
+		}
+		if(bk->ret && !anyret) {
+			anyret = 1;
+			for(unsigned k = 0; k < d->nrs; k++) {
+				if(!d->blk[d->rs[k]].reach) {d->blk[d->rs[k]].reach = 1; st[sp++] = d->rs[k];}
+			}
+		}
+		for(unsigned k = 0; k < 3; k++) {
+			if(nx[k] != IDLEASM_DF_NONE && !d->blk[nx[k]].reach) {d->blk[nx[k]].reach = 1; st[sp++] = nx[k];}
+		}
+	}
+	free(st);
+	if(!anyret) {d->nrs = 0;}
+	return 1;
+}
+
+uint64_t idleasm_dflive(dfprm_t *d, dfblk_t *bk, uint64_t live, int dse) {
+	/*
+		* registers live before the block BK given LIVE after it, with DSE pure
+		* instructions that write only dead registers are deleted and decided
+		* compare-and-branches whose atr0 is dead become jmp or nothing
+	*/
+	uint64_t use, def;
+	for(unsigned i = bk->e; i-- > bk->b;) {
+		if(d->kind[i] || (d->f[i] & IDLEASM_SLOT_DEL)) {continue;}
+		unsigned fl = idleasm_dfuse(&d->o[i], &use, &def);
+		if(dse && d->kb[i] && !(live & IDLEASM_DFR(0))) {
+			if(d->kb[i] == 2) {d->f[i] |= IDLEASM_SLOT_DEL; d->kb[i] = 0; continue;}
+			d->o[i].op = JMP; d->o[i].arg0 = d->o[i].arg1 = 0; d->kb[i] = 0;
+			continue;
+		}
+		if(dse && (fl & IDLEASM_DF_PURE) && def && !(def & live)) {
+			d->f[i] |= IDLEASM_SLOT_DEL;
+			if(d->o[i].op == MOV_W || d->o[i].op == UMULH_W) {d->f[i + 1] |= IDLEASM_SLOT_DEL;}
+			continue;
+		}
+		live = (live & ~def) | use;
+	}
+	return live;
+}
+
+int idleasm_dfround(dfprm_t *d) {
+	/* one pass of the analyses, 1 when something changed, -1 when the program is out of reach of the model */
+	unsigned ch = 0, nb;
+	dfstat_t s;
+	if(!idleasm_dfcfg(d)) {return -1;}
+	nb = d->nb;
+
+	for(unsigned k = 0; k < nb; k++) {
+		if(d->blk[k].reach) {continue;}
+		for(unsigned i = d->blk[k].b; i < d->blk[k].e; i++) {
+			if(!(d->f[i] & IDLEASM_SLOT_DEL)) {d->f[i] |= IDLEASM_SLOT_DEL; ch = 1;}
+		}
+	}
+
+	/* constants and copies, forward to a fixed point and then rewritten */
+	d->nr = 0;
+	for(unsigned r = 0; r < 64; r++) {
+		if((d->um >> r) & 1) {d->rl[r] = (uint8_t)d->nr++;}
+	}
+	d->skn = idleasm_dfalloc((size_t)2*nb*sizeof(uint64_t));
+	d->sv = idleasm_dfalloc((size_t)nb*d->nr*sizeof(uint64_t) + 1);
+	d->scp = idleasm_dfalloc((size_t)nb*d->nr + 1);
+	d->vis = idleasm_dfalloc(nb);
+	unsigned *wl = idleasm_dfalloc((size_t)(nb + 1)*sizeof(unsigned)), wn = 0;
+
+	memset(&s, 0, sizeof(s));
+	memset(s.cp, 0xff, sizeof(s.cp));
+	s.kn = d->um;
+	idleasm_dfmeet(d, 0, &s);
+	wl[wn++] = 0; d->blk[0].inq = 1;
+	while(wn) {
+		dfblk_t *bk = &d->blk[wl[--wn]];
+		bk->inq = 0;
+		idleasm_dfload(d, (unsigned)(bk - d->blk), &s);
+		for(unsigned i = bk->b; i < bk->e; i++) {idleasm_dfstep(d, &s, i, 0);}
+		unsigned nx = bk->ret ? d->nrs : 0;
+		for(unsigned k = 0; k < nx + 2; k++) {
+			unsigned t = k == 0 ? bk->s0 : k == 1 ? bk->s1 : d->rs[k - 2];
+			if(t == IDLEASM_DF_NONE || !idleasm_dfmeet(d, t, &s) || d->blk[t].inq) {continue;}
+			d->blk[t].inq = 1; wl[wn++] = t;
+		}
+	}
+	for(unsigned k = 0; k < nb; k++) {
+		if(!d->vis[k]) {continue;}
+		idleasm_dfload(d, k, &s);
+		for(unsigned i = d->blk[k].b; i < d->blk[k].e; i++) {ch |= idleasm_dfstep(d, &s, i, 1);}
+	}
+	free(wl); free(d->skn); free(d->sv); free(d->scp); free(d->vis);
+
+	/* liveness, backward to a fixed point, then dead stores go */
+	for(unsigned it = 0, lc = 1; lc && it < 8; it++) {
+		for(unsigned c = 1; c;) {
+			uint64_t rsl = 0;
+			c = 0;
+			for(unsigned k = 0; k < d->nrs; k++) {rsl |= d->blk[d->rs[k]].lin;}
+			for(unsigned k = nb; k-- > 0;) {
+				dfblk_t *bk = &d->blk[k];
+				if(!bk->reach) {continue;}
+				uint64_t out = (bk->ret ? rsl : 0);
+				if(bk->s0 != IDLEASM_DF_NONE) {out |= d->blk[bk->s0].lin;}
+				if(bk->s1 != IDLEASM_DF_NONE) {out |= d->blk[bk->s1].lin;}
+				uint64_t in = idleasm_dflive(d, bk, out, 0);
+				if(in != bk->lin || out != bk->lout) {bk->lin = in; bk->lout = out; c = 1;}
+			}
+		}
+		lc = 0;
+		for(unsigned k = 0; k < nb; k++) {
+			dfblk_t *bk = &d->blk[k];
+			if(!bk->reach) {continue;}
+			unsigned before = 0, after = 0;
+			for(unsigned i = bk->b; i < bk->e; i++) {before += !(d->f[i] & IDLEASM_SLOT_DEL) + (d->kb[i] != 0);}
+			idleasm_dflive(d, bk, bk->lout, 1);
+			for(unsigned i = bk->b; i < bk->e; i++) {after += !(d->f[i] & IDLEASM_SLOT_DEL) + (d->kb[i] != 0);}
+			if(before != after) {lc = 1; ch = 1;}
+		}
+	}
+
+	/* a jmp left pointing at the next kept slot goes too, the peephole pass would thread it instead */
+	for(unsigned i = 0; i < d->n; i++) {
+		if(d->kind[i] || (d->f[i] & IDLEASM_SLOT_DEL) || d->o[i].op != JMP) {continue;}
+		unsigned g = (unsigned)((int64_t)i + (int32_t)d->o[i].imm + 1);
+		if(idleasm_nextkept(d->f, g, d->n) == idleasm_nextkept(d->f, i + 1, d->n)) {d->f[i] |= IDLEASM_SLOT_DEL; ch = 1;}
+	}
+	return ch;
+}
+
+int idleasm_dataflow(idleprm_t *prm) {
+	/*
+		* constant and copy propagation, dead store and dead block elimination,
+		* repeated while a round changes something, the slots that go are only
+		* flagged and the peephole pass drops them and fixes the branches up,
+		* a program that reads its own code or takes label addresses is kept
+	*/
+	dfprm_t d;
+	unsigned n = prm->isvd;
+	if(prm->absref || !n) {return 0;}
+	for(unsigned i = 0; i < n; i++) {
+		if(!(prm->flg[i] & IDLEASM_SLOT_DATA) && prm->svd[i].op == INT && prm->svd[i].imm == IDLEBIN_INTLOADID) {return 0;}
+	}
+	memset(&d, 0, sizeof(d));
+	d.o = prm->svd;
+	d.f = prm->flg;
+	d.n = n;
+	d.kind = idleasm_dfalloc(n + 1);
+	d.bi = idleasm_dfalloc((size_t)(n + 1)*sizeof(unsigned));
+	d.blk = idleasm_dfalloc((size_t)(n + 1)*sizeof(dfblk_t));
+	d.rs = idleasm_dfalloc((size_t)(n + 1)*sizeof(unsigned));
+	d.kb = idleasm_dfalloc(n + 1);
+
+	/* a round that finds the program out of reach of the model leaves the slots as they are */
+	opsvd_t *so = idleasm_dfalloc((size_t)n*sizeof(opsvd_t));
+	uint8_t *sf = idleasm_dfalloc(n);
+	memcpy(so, prm->svd, (size_t)n*sizeof(opsvd_t));
+	memcpy(sf, prm->flg, n);
+	for(unsigned round = 0; round < 16; round++) {
+		memset(d.kb, 0, n + 1);
+		int r = idleasm_dfround(&d);
+		if(r < 0) {
+			memcpy(prm->svd, so, (size_t)n*sizeof(opsvd_t));
+			memcpy(prm->flg, sf, n);
+			break;
+		}
+		if(!r) {break;}
+	}
+	free(so); free(sf);
+	free(d.kind); free(d.bi); free(d.blk); free(d.rs); free(d.kb);
 	return 0;
 }
 
+const char *idleasm_mapfile(const char *path, size_t *n) {
+	/*
+		* the lexer works on the whole source in place, POSIX maps it,
+		* elsewhere it is read into one buffer
+	*/
+#if !defined(_WIN32)
+	struct stat sb; void *p;
+	int fd = open(path, O_RDONLY);
+	if(fd < 0 || fstat(fd, &sb)) {idleasm_error(IDLEASM_ERR_FILE_NOT_READ, "failed to read file");}
+	*n = (size_t)sb.st_size;
+	if(!*n) {close(fd); return "";}
+	p = mmap(NULL, *n, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(p == MAP_FAILED) {idleasm_error(IDLEASM_ERR_FILE_NOT_READ, "failed to read file");}
+	posix_madvise(p, *n, POSIX_MADV_SEQUENTIAL);
+	return p;
+#else
+	FILE *f = fopen(path, "rb"); char *p; long l;
+	if(!f || fseek(f, 0, SEEK_END) || (l = ftell(f)) < 0 || fseek(f, 0, SEEK_SET)) {idleasm_error(IDLEASM_ERR_FILE_NOT_READ, "failed to read file");}
+	*n = (size_t)l;
+	p = malloc(*n + 1);
+	if(!p) {idleasm_error(IDLEASM_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+	if(fread(p, 1, *n, f) != *n) {idleasm_error(IDLEASM_ERR_FILE_NOT_READ, "failed to read file");}
+	fclose(f);
+	return p;
+#endif
+}
+
+void idleasm_unmapfile(const char *p, size_t n) {
+#if !defined(_WIN32)
+	if(n) {munmap((void *)p, n);}
+#else
+	free((void *)p);
+#endif
+}
+
+int idleasm_dbgwrite(idleprm_t *prm, const char *path, const char *src) {
+	/*
+		* debug map for tools that decode or profile a binary:
+		* label <name> <slot> for every label, then line <slot> <line>
+		* wherever the source line changes
+	*/
+	FILE *f = fopen(path, "w");
+	if(!f) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	fprintf(f, "idledbg 1\nfile %s\n", src);
+	for(labelstat_t *lb = prm->lbl; lb; lb = lb->next) {
+		if(lb->def) {fprintf(f, "label %.*s %u\n", (int)lb->len, lb->lb_name, (unsigned)lb->ln);}
+	}
+	for(unsigned i = 0; i < prm->isvd; i++) {
+		if(!i || prm->lin[i] != prm->lin[i - 1]) {fprintf(f, "line %u %u\n", i, prm->lin[i]);}
+	}
+	if(fclose(f)) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	return 0;
+}
+
+uint64_t idleasm_hash64(uint64_t h, const void *p, size_t n) {
+	/* FNV-1a continued from H */
+	const uint8_t *s = p;
+	for(size_t i = 0; i < n; i++) {h = (h ^ s[i]) * UINT64_C(1099511628211);}
+	return h;
+}
+
+uint64_t idleasm_objkey(const char *src, size_t n, unsigned flags) {
+	/*
+		* cache key of an object: the source bytes, the object format, the
+		* assembler (IDLEASM_VERSION changes with the code it writes) and the
+		* options FLAGS it was run with
+	*/
+	uint32_t k[3] = {IDLEOBJ_VERSION, IDLEASM_VERSION, flags};
+	return idleasm_hash64(idleasm_hash64(UINT64_C(14695981039346656037), k, sizeof(k)), src, n);
+}
+
+int idleasm_objcached(const char *path, uint64_t hash) {
+	/* an object with the same key, see idleasm_objkey, is kept as it is */
+	idleobj_hdr h; int r;
+	FILE *f = fopen(path, "rb");
+	if(!f) {return 0;}
+	r = fread(&h, sizeof(h), 1, f) == 1 && !memcmp(h.magic, IDLEOBJ_MAGIC, 4) && h.version == IDLEOBJ_VERSION && h.hash == hash;
+	fclose(f);
+	return r;
+}
+
+int idleasm_impwrite(idleprm_t *prm, FILE *f) {
+	/*
+		* names of the host imports and the footer after the slots, nothing
+		* when there are none, compact code always has the footer
+	*/
+	idlebin_ftr h; labelstat_t **im; uint32_t l = 0;
+	if(!prm->nimp && !prm->zip) {return 0;}
+	im = idleasm_aalloc(&prm->ar, (prm->nimp + 1)*sizeof(labelstat_t *));
+	for(labelstat_t *lb = prm->imp; lb; lb = lb->next) {im[lb->idx] = lb; l += lb->len + 1;}
+	memcpy(h.magic, prm->zip ? IDLEBIN_ZMAGIC : IDLEBIN_MAGIC, 4);
+	h.nimp = prm->nimp;
+	h.strsz = (l + sizeof(opsvd_t) - 1) / sizeof(opsvd_t) * sizeof(opsvd_t);
+	h.nslot = prm->isvd;
+	for(unsigned i = 0; i < prm->nimp; i++) {
+		if(fwrite(im[i]->lb_name, 1, im[i]->len, f) != im[i]->len || fputc(0, f) == EOF) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	}
+	for(; l < h.strsz; l++) {
+		if(fputc(0, f) == EOF) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	}
+	if(fwrite(&h, sizeof(h), 1, f) != 1) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	return 0;
+}
+
+int idleasm_objwrite(idleprm_t *prm, FILE *f, uint64_t hash) {
+	/*
+		* the header goes last, an object cut short by a failed write never
+		* carries the hash of its source
+	*/
+	idleobj_hdr h; idleobj_sym y; idleobj_rel rl; uint32_t off = 0;
+	memset(&h, 0, sizeof(h));
+	for(labelstat_t *lb = prm->lbl; lb; lb = lb->next) {lb->idx = h.nsym++; h.strsz += lb->len;}
+	h.nslot = prm->isvd;
+	h.nrel = prm->ifix;
+	if(fwrite(&h, sizeof(h), 1, f) != 1) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	if(fwrite(prm->svd, sizeof(opsvd_t), prm->isvd, f) != prm->isvd) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	for(unsigned i = 0; i < prm->isvd; i++) {
+		if(fputc(prm->flg[i] & IDLEASM_SLOT_DATA ? IDLEOBJ_SLOT_DATA : 0, f) == EOF) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	}
+	for(labelstat_t *lb = prm->lbl; lb; lb = lb->next) {
+		y.name = off; y.len = lb->len; y.slot = (uint32_t)lb->ln;
+		y.flags = (lb->def ? IDLEOBJ_SYM_DEF : 0) | (lb->glb ? IDLEOBJ_SYM_GLOBAL : 0);
+		off += lb->len;
+		if(fwrite(&y, sizeof(y), 1, f) != 1) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	}
+	for(unsigned i = 0; i < prm->ifix; i++) {
+		if(prm->fix[i].kind != IDLEASM_FIX_REL) {
+			idleasm_pos = prm->fix[i].pos;
+			idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "label in expression is not supported in an object file");
+		}
+		rl.slot = prm->fix[i].slot; rl.sym = prm->fix[i].lb->idx;
+		if(fwrite(&rl, sizeof(rl), 1, f) != 1) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	}
+	for(labelstat_t *lb = prm->lbl; lb; lb = lb->next) {
+		if(fwrite(lb->lb_name, 1, lb->len, f) != lb->len) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	}
+	memcpy(h.magic, IDLEOBJ_MAGIC, 4);
+	h.version = IDLEOBJ_VERSION;
+	h.hash = hash;
+	if(fseek(f, 0, SEEK_SET) || fwrite(&h, sizeof(h), 1, f) != 1) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	return 0;
+}
+
+int idleasm_tokname(lexstat_t *st, unsigned k) {
+	/* a name for equ or macro, registers and mnemonics are taken */
+	const char *a = idleasm_tokp(st, k); unsigned l = st->tok[k].len;
+	idleasm_tokpos(st, k);
+	if(!isident_str(a, l) || isregister_str(a, l) || isoperand_str(a, l)) {idleasm_error(IDLEASM_ERR_LABEL_NAME_IS_NOT_IDENT, "name is not identifier");}
+	return 0;
+}
+
+unsigned idleasm_tokend(lexstat_t *st, unsigned k) {
+	/* first ',' or ';' at or after K */
+	while(k < st->token_count && !idleasm_tokis(st, k, ",") && !idleasm_tokis(st, k, ";")) {k++;}
+	return k;
+}
+
+int idleasm_line(lexstat_t *st, idleprm_t *prm, size_t b, size_t e);
+
+int idleasm_expand(lexstat_t *st, idleprm_t *prm, macro_t *mc, unsigned k) {
+	/*
+		* the arguments from token K on are cut at the commas, the body is
+		* copied with every parameter name replaced by the source text of
+		* its argument and the copy is assembled line by line, diagnostics
+		* point at the invocation
+	*/
+	const char **as = idleasm_aalloc(&prm->ar, (mc->np + 1)*sizeof(char *));
+	unsigned *al = idleasm_aalloc(&prm->ar, (mc->np + 1)*sizeof(unsigned)), na = 0;
+	for(unsigned m; k < st->token_count && !idleasm_tokis(st, k, ";"); k = m + (m < st->token_count && idleasm_tokis(st, m, ","))) {
+		m = idleasm_tokend(st, k);
+		if(m == k || na == mc->np) {idleasm_tokpos(st, k); idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "wrong number of macro arguments");}
+		as[na] = idleasm_tokp(st, k);
+		al[na++] = (unsigned)(st->tok[m-1].off + st->tok[m-1].len - st->tok[k].off);
+	}
+	if(na != mc->np) {idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "wrong number of macro arguments");}
+	if(prm->depth >= IDLEASM_MACRODEPTH) {idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "macro expansion too deep");}
+
+	size_t n = 0, cap = mc->e - mc->b + 1;
+	char *buf = idleasm_aalloc(&prm->ar, cap);
+	for(size_t i = mc->b; i < mc->e;) {
+		size_t j = i;
+		while(j < mc->e && (isalnum((unsigned char)mc->src[j]) || mc->src[j] == '_')) {j++;}
+		const char *w = &mc->src[i]; size_t wl = j > i ? j - i : 1;
+		for(unsigned a = 0; j > i && !isdigit((unsigned char)mc->src[i]) && a < mc->np; a++) {
+			if(mc->pl[a] == wl && !memcmp(mc->par[a], w, wl)) {w = as[a]; wl = al[a]; break;}
+		}
+		if(n + wl > cap) {buf = idleasm_agrow(&prm->ar, buf, cap, 2*(n + wl)); cap = 2*(n + wl);}
+		memcpy(&buf[n], w, wl);
+		n += wl;
+		i += j > i ? j - i : 1;
+	}
+
+	lexstat_t ex; srcpos_t p = idleasm_pos;
+	idleasm_lexstat_alloc(&ex, &prm->ar, buf, n);
+	prm->depth++;
+	for(size_t b = 0, q; b < n; b = q) {
+		const char *nl = memchr(&buf[b], '\n', n - b);
+		q = nl ? (size_t)(nl - buf) + 1 : n;
+		idleasm_line(&ex, prm, b, q);
+		idleasm_pos = p;
+	}
+	if(prm->mdef) {idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "macro without endm");}
+	prm->depth--;
+	return 0;
+}
+
+int idleasm_directive(lexstat_t *st, idleprm_t *prm, size_t e) {
+	/*
+		* name equ expr;             named constant, defined before use
+		* macro name p0, p1, ...;    the lines up to endm; are its body
+		* [label:] name a0, a1, ...; expands the macro
+		* returns 1 when the line was one of them, chunks of a parallel run
+		* cannot see each other and hand the source back to one thread
+	*/
+	labelstat_t *lb; uint64_t v; unsigned S = 0;
+	if(st->token_count >= 3 && idleasm_streq(idleasm_tokp(st, 1), st->tok[1].len, "equ")) {
+		if(idleasm_chunk) {idleasm_error(IDLEASM_ERR_SERIAL_ONLY, "equ in a parallel run");}
+		idleasm_tokname(st, 0);
+		unsigned m = 2;
+		while(m < st->token_count && !idleasm_tokis(st, m, ";")) {m++;}
+		if(m == 2) {idleasm_tokpos(st, 2); idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "incorrect instruction");}
+		idleasm_tokpos(st, 2);
+		if(idleasm_expr(prm, idleasm_tokp(st, 2), (unsigned)(st->tok[m-1].off + st->tok[m-1].len - st->tok[2].off), &v)) {
+			idleasm_error(IDLEASM_ERR_INCORRECT_ARGUMENT, "label in expression must be defined before use here");
+		}
+		lb = idleasm_intern(prm, idleasm_tokp(st, 0), st->tok[0].len);
+		idleasm_tokpos(st, 0);
+		if(lb->cst || lb->def) {idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "name already defined");}
+		lb->cst = IDLEASM_NAME_CONST;
+		lb->ln = v;
+		prm->ncst++;
+		return 1;
+	}
+	if(st->token_count >= 2 && idleasm_streq(idleasm_tokp(st, 0), st->tok[0].len, "macro")) {
+		if(idleasm_chunk) {idleasm_error(IDLEASM_ERR_SERIAL_ONLY, "macro in a parallel run");}
+		idleasm_tokname(st, 1);
+		macro_t *mc = idleasm_aalloc(&prm->ar, sizeof(macro_t));
+		mc->par = idleasm_aalloc(&prm->ar, st->token_count*sizeof(char *));
+		mc->pl = idleasm_aalloc(&prm->ar, st->token_count*sizeof(unsigned));
+		for(unsigned k = 2; k < st->token_count && !idleasm_tokis(st, k, ";"); k += 2) {
+			idleasm_tokname(st, k);
+			mc->par[mc->np] = idleasm_tokp(st, k);
+			mc->pl[mc->np++] = st->tok[k].len;
+			if(!idleasm_tokis(st, k+1, ",") && !idleasm_tokis(st, k+1, ";")) {idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "unknown separator");}
+		}
+		lb = idleasm_intern(prm, idleasm_tokp(st, 1), st->tok[1].len);
+		idleasm_tokpos(st, 1);
+		if(lb->cst || lb->def) {idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "name already defined");}
+		lb->cst = IDLEASM_NAME_MACRO;
+		mc->lb = lb;
+		mc->next = prm->mac;
+		prm->mac = mc;
+		mc->src = st->src;
+		mc->b = mc->e = e;
+		mc->pos = idleasm_pos;
+		prm->mdef = mc;
+		return 1;
+	}
+	if(!prm->mac) {return 0;}
+	if(st->token_count >= 2 && idleasm_tokis(st, 1, ":")) {S = 2;}
+	if(S >= st->token_count || !isident_str(idleasm_tokp(st, S), st->tok[S].len)) {return 0;}
+	lb = *idleasm_lhtslot(prm, idleasm_tokp(st, S), st->tok[S].len, idleasm_hash(idleasm_tokp(st, S), st->tok[S].len, 0));
+	if(!lb || lb->cst != IDLEASM_NAME_MACRO) {return 0;}
+	macro_t *mc = prm->mac;
+	while(mc->lb != lb) {mc = mc->next;}
+	if(S) {
+		idleasm_enumtag(st, &S);
+		idleasm_push_label(st, prm);
+	}
+	idleasm_expand(st, prm, mc, S + 1);
+	return 1;
+}
+
+int idleasm_line(lexstat_t *st, idleprm_t *prm, size_t b, size_t e) {
+	idleasm_token(prm->table, st, b, e);
+
+	if(prm->mdef) {
+		/* the body of an open macro is only scanned for its endm */
+		if(st->token_count && idleasm_streq(idleasm_tokp(st, 0), st->tok[0].len, "endm")) {prm->mdef = NULL;}
+		else {prm->mdef->e = e;}
+		return 0;
+	}
+
+	if(idleasm_directive(st, prm, e)) {return 0;}
+
+	idleasm_enumerator(st, prm);
+
+	idleasm_push_label(st, prm);
+
+	idleasm_push_instr(st, prm);
+
+	return 0;
+}
+
+int idleasm_assemble(lexstat_t *st, idleprm_t *prm, size_t b, size_t e) {
+	for(size_t q; b < e; b = q) {
+		const char *nl = memchr(&st->src[b], '\n', e - b);
+		q = nl ? (size_t)(nl - st->src) + 1 : e;
+
+		idleasm_pos.line += 1;
+		idleasm_pos.col = 1;
+
+		idleasm_line(st, prm, b, q);
+	}
+	if(prm->mdef) {idleasm_pos = prm->mdef->pos; idleasm_error(IDLEASM_ERR_INCORRECT_INSTRUCTION, "macro without endm");}
+	return 0;
+}
+
+struct idlechunk_t {
+	/*
+		* one line-aligned piece of the source assembled by its own thread,
+		* slots, labels and line numbers are local to the chunk until the merge
+		* ERR = first error of the chunk, later chunks never report theirs first
+	*/
+	idleprm_t prm;
+	lexstat_t st;
+	size_t b;
+	size_t e;
+	unsigned lines;
+	int err;
+	const char *msg;
+	srcpos_t pos;
+	pthread_t th;
+};
+
+void idleasm_chunkerr(int e, const char *msg) {
+	idlechunk_t *c = idleasm_chunk;
+	c->err = e;
+	c->msg = msg;
+	c->pos = idleasm_pos;
+	pthread_exit(NULL);
+}
+
+void *idleasm_chunkrun(void *a) {
+	idlechunk_t *c = a;
+	idleasm_chunk = c;
+	idleasm_pos.file = c->pos.file;
+	idleasm_assemble(&c->st, &c->prm, c->b, c->e);
+	c->lines = idleasm_pos.line;
+	return NULL;
+}
+
+int idleasm_parallel(idleprm_t *prm, const char *src, size_t size, const char *table, unsigned nth) {
+	/*
+		* the source is cut after a newline into NTH chunks that are lexed,
+		* classified and encoded concurrently, the merge then walks them in
+		* source order: labels are defined first one wins, slots are appended
+		* and every reference becomes a fixup of the whole program, so the
+		* result is the one of a single pass
+	*/
+	idlechunk_t *ch = idleasm_aalloc(&prm->ar, nth*sizeof(idlechunk_t));
+	unsigned n = 0, base = 0, line = 0;
+
+	for(size_t b = 0; b < size && n < nth; n++) {
+		idlechunk_t *c = &ch[n];
+		size_t e = n + 1 == nth ? size : size / nth * (n + 1);
+		if(e <= b) {e = b + 1;}
+		if(e < size) {
+			const char *nl = memchr(&src[e - 1], '\n', size - (e - 1));
+			e = nl ? (size_t)(nl - src) + 1 : size;
+		}
+		idleasm_prmalloc(&c->prm, NULL);
+		c->prm.defer = 1;
+		if(prm->ncap) {
+			c->prm.ncap = IDLEASM_SVDCOUNT;
+			c->prm.lin = idleasm_aalloc(&c->prm.ar, c->prm.ncap*sizeof(uint32_t));
+		}
+		idleasm_lexstat_alloc(&c->st, &c->prm.ar, src, size);
+		c->prm.table = table;
+		c->b = b;
+		c->e = e;
+		c->err = 0;
+		c->pos = idleasm_pos;
+		if(pthread_create(&c->th, NULL, idleasm_chunkrun, c)) {idleasm_error(IDLEASM_ERR_FAILED_EXIT, "failed to start thread");}
+		b = e;
+	}
+
+	for(unsigned i = 0; i < n; i++) {pthread_join(ch[i].th, NULL);}
+
+	for(unsigned i = 0; i < n; i++) {
+		if(ch[i].err != IDLEASM_ERR_SERIAL_ONLY) {continue;}
+		for(unsigned k = 0; k < n; k++) {idleasm_prmfree(&ch[k].prm);}
+		return 1;
+	}
+
+	for(unsigned i = 0; i < n; i++) {
+		idlechunk_t *c = &ch[i];
+		if(c->err) {
+			idleasm_pos = c->pos;
+			idleasm_pos.line += line;
+			idleasm_error(c->err, c->msg);
+		}
+		for(labelstat_t *lb = c->prm.lbl; lb; lb = lb->next) {
+			if(lb->def) {idleasm_build_label(prm, lb->lb_name, lb->len, base + lb->ln);}
+			idleasm_intern(prm, lb->lb_name, lb->len)->glb |= lb->glb;
+		}
+		for(unsigned k = 0; k < c->prm.isvd; k++) {
+			if(prm->ncap) {idleasm_pos.line = line + c->prm.lin[k];}
+			idleasm_emit(prm, &c->prm.svd[k], c->prm.flg[k]);
+		}
+		for(unsigned k = 0; k < c->prm.ifix; k++) {
+			fixstat_t *f = &c->prm.fix[k];
+			idleasm_pos = f->pos;
+			idleasm_pos.line += line;
+			prm->isvd = base + f->slot;
+			if(f->kind == IDLEASM_FIX_REL) {idleasm_build_fixup(prm, f->lb->lb_name, f->lb->len);}
+			else {idleasm_build_exprfix(prm, f->kind, f->lb->lb_name, f->lb->len);}
+		}
+		prm->absref |= c->prm.absref;
+		base += c->prm.isvd;
+		prm->isvd = base;
+		line += c->lines;
+		idleasm_prmfree(&c->prm);
+	}
+
+	idleasm_pos.line = line;
+	return 0;
+}
+
+int idleasm_main(int argc, char **argv) {
+	char *fin = NULL, *fout = NULL, *fdbg = NULL; int opt = 0, obj = 0, zip = 0; unsigned nth = 1;
+
+	for(int a = 1; a < argc; a++) {
+		if(!strcmp(argv[a], "-O")) {opt = 1;}
+		else if(!strcmp(argv[a], "-O2")) {opt = 2;}
+		else if(!strcmp(argv[a], "-g") || !strcmp(argv[a], "-j")) {
+			/* an option that takes a value fails without one rather than being dropped */
+			if(a + 1 >= argc) {fin = NULL; break;}
+			if(argv[a][1] == 'g') {fdbg = argv[++a];} else {nth = (unsigned)strtoul(argv[++a], NULL, 10);}
+		}
+		else if(!strcmp(argv[a], "-c")) {obj = 1;}
+		else if(!strcmp(argv[a], "--compact")) {zip = 1;}
+		else if(!fin) {fin = argv[a];}
+		else if(!fout) {fout = argv[a];}
+	}
+
+	if(!fin || !fout) {
+		fprintf(stderr, "usage: asm program.idsm program.bin [-O|-O2] [-g program.map] [-j threads] [--compact] [-c]\n");
+		return IDLEASM_ERR_FAILED_EXIT;
+	}
+
+	size_t size;
+	const char *src = idleasm_mapfile(fin, &size);
+	uint64_t hash = obj ? idleasm_objkey(src, size, (unsigned)opt | (fdbg ? 4u : 0) | (zip ? 8u : 0)) : 0;
+
+	if(obj && idleasm_objcached(fout, hash)) {idleasm_unmapfile(src, size); return 0;}
+
+	FILE *fo = fopen(fout, "wb");
+
+	if(fo == NULL) {idleasm_error(IDLEASM_ERR_FILE_NOT_READ, "failed to read file");}
+
+	idleasm_out = fout;
+
+	lexstat_t st; idleprm_t prm; char table[256];
+
+	idleasm_hash_init();
+
+	/* an object keeps every label reference as a relocation for the linker */
+	if(obj) {opt = 0; zip = 0;}
+
+	idleasm_prmalloc(&prm, opt || obj || zip ? NULL : fo);
+
+	prm.defer = obj;
+
+	if(fdbg) {
+		prm.ncap = IDLEASM_SVDCOUNT;
+		prm.lin = idleasm_aalloc(&prm.ar, prm.ncap*sizeof(uint32_t));
+	}
+
+	idleasm_lexstat_alloc(&st, &prm.ar, src, size);
+
+	idleasm_bintable_build("\r\v\t\n ", "()[]{},:;", "+*-/%^&|~<>", "\"\'`", table);
+
+	prm.table = table;
+
+	idleasm_special_init(table);
+
+	idleasm_pos.file = fin;
+
+	/* chunks below IDLEASM_CHUNKMIN bytes are not worth a thread */
+	if(nth > size / IDLEASM_CHUNKMIN) {nth = (unsigned)(size / IDLEASM_CHUNKMIN);}
+
+	if(nth <= 1 || idleasm_parallel(&prm, src, size, table, nth)) {
+		idleasm_pos.line = 0;
+		idleasm_assemble(&st, &prm, 0, size);
+	}
+
+	idleasm_pos.line = 0;
+
+	if(obj) {
+		idleasm_objwrite(&prm, fo, hash);
+	} else {
+		idleasm_fixup(&prm);
+	}
+
+	if(opt) {
+		if(opt > 1) {idleasm_dataflow(&prm);}
+
+		idleasm_peephole(&prm);
+	}
+
+	if(zip && idleasm_compact(&prm)) {
+		size_t nw = (prm.isvd + 1) & ~1u;
+		if(fwrite(prm.zw, sizeof(uint32_t), nw, fo) != nw || fwrite(prm.zp, sizeof(uint64_t), prm.nzp, fo) != prm.nzp) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	} else if(opt || zip) {
+		if(fwrite(prm.svd, sizeof(opsvd_t), prm.isvd, fo) != prm.isvd) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	}
+
+	if(!obj) {idleasm_impwrite(&prm, fo);}
+
+	if(fdbg) {idleasm_dbgwrite(&prm, fdbg, fin);}
+
+	idleasm_prmfree(&prm);
+
+	idleasm_unmapfile(src, size);
+
+	if(fclose(fo)) {idleasm_error(IDLEASM_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	return idleasm_main(argc, argv);
+}
+
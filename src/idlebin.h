@@ -0,0 +1,60 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef IDLEBIN_H
+#define IDLEBIN_H
+
+#include <stdint.h>
+
+/*
+	* host imports of a binary written by asm: NSLOT slots, STRSZ bytes of
+	* NUL-terminated import names padded to a whole slot, then the footer
+	* INT IDLEBIN_INTCOUNT + k calls import k, lower numbers are built in
+	* INT IDLEBIN_INTLOADID (loadid) reads the program's own slots, so tools
+	* that move or drop slots leave a program that uses it alone
+	* a binary without imports is the bare slots
+	*
+	* compact binary (asm --compact): footer magic IDLEBIN_ZMAGIC, always
+	* present, NSLOT counts the 32-bit code words, one per instruction,
+	* padded with zero to a whole slot, then the pool of 64-bit entries up
+	* to the import names, entry 0 is zero
+	* short word, bit 8 clear: op in bits 0-7, arg1 in 9-14, arg2 in 15-20,
+	* imm in 21-31 sign-extended to 32 bits
+	* long word, bit 8 set: op and arg1 as above, pool index in 15-31, the
+	* entry holds imm in bits 0-31 and arg2 in 32-39, or the whole literal
+	* of mov/umulh wide
+	* branches count words the way slots are counted
+*/
+
+#define IDLEBIN_MAGIC "IDLI"
+#define IDLEBIN_ZMAGIC "IDLZ"
+#define IDLEBIN_INTCOUNT 13
+#define IDLEBIN_INTLOADID 6
+
+#define IDLEBIN_ZLONG 0x100u
+#define IDLEBIN_ZIMMMIN (-1024)
+#define IDLEBIN_ZIMMMAX 1023
+#define IDLEBIN_ZREGMAX 63
+#define IDLEBIN_ZPOOLMAX 0x1ffff
+
+typedef struct idlebin_ftr {
+	char magic[4];
+	uint32_t nimp;
+	uint32_t strsz;
+	uint32_t nslot;
+} idlebin_ftr;
+
+#endif
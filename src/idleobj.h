@@ -0,0 +1,61 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef IDLEOBJ_H
+#define IDLEOBJ_H
+
+#include <stdint.h>
+
+/*
+	* relocatable object written by asm -c and read by ld:
+	* header, NSLOT 8-byte slots, NSLOT slot flags, NSYM symbols,
+	* NREL relocations and STRSZ bytes of symbol names
+	* every label reference is a relocation, the linker stores
+	* target - slot - 1 into the imm of the slot
+	* HASH is the rebuild cache key: source, format, assembler and options
+*/
+
+#define IDLEOBJ_MAGIC "IDLO"
+#define IDLEOBJ_VERSION 1
+
+#define IDLEOBJ_SYM_DEF 0x01
+#define IDLEOBJ_SYM_GLOBAL 0x02
+
+#define IDLEOBJ_SLOT_DATA 0x01
+
+typedef struct idleobj_hdr {
+	char magic[4];
+	uint32_t version;
+	uint64_t hash;
+	uint32_t nslot;
+	uint32_t nsym;
+	uint32_t nrel;
+	uint32_t strsz;
+} idleobj_hdr;
+
+typedef struct idleobj_sym {
+	uint32_t name;
+	uint32_t len;
+	uint32_t slot;
+	uint32_t flags;
+} idleobj_sym;
+
+typedef struct idleobj_rel {
+	uint32_t slot;
+	uint32_t sym;
+} idleobj_rel;
+
+#endif
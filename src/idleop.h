@@ -0,0 +1,31 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef IDLEOP_H
+#define IDLEOP_H
+
+typedef enum idlevm_op {
+	HLT=0, NOP, ADD_R, ADD_I, SUB_R, SUB_I, RSB_R, RSB_I, MUL_R, MUL_I, DIV_R, DIV_I, RDV_R, RDV_I, MOD_R, MOD_I, RMD_R, RMD_I, IMUL_R, IMUL_I, IDIV_R,
+	IDIV_I, IRDV_R, IRDV_I, AND_R, AND_I, OR_R, OR_I, XOR_R, XOR_I, NOT_R, SHR_R, SHR_I, SHL_R, SHL_I, MOV_R, MOV_I, XCHG, CMP_R, CMP_I, JMP, JE, JL, JG, JLE,
+	JGE, JNE, INT, PUSH, POP, ASR_R, ASR_I, BT_R, BT_I, BTS_R, BTS_I, BTR_R, BTR_I, BTI_R, BTI_I, CALL, RET, LDB_R, LDB_I, LDDB_R, LDDB_I, LDQB_R, LDQB_I,
+	STB_R, STB_I, STDB_R, STDB_I, STQB_R, STQB_I, MOV_W, JE_R, JE_I, JL_R, JL_I, JG_R, JG_I, JLE_R, JLE_I, JGE_R, JGE_I, JNE_R, JNE_I,
+	LOOP, CMOVE_R, CMOVE_I, CMOVL_R, CMOVL_I, CMOVG_R, CMOVG_I, CMOVLE_R, CMOVLE_I, CMOVGE_R, CMOVGE_I, CMOVNE_R, CMOVNE_I, SETE, SETL,
+	SETG, SETLE, SETGE, SETNE, MIN_R, MIN_I, MAX_R, MAX_I, IMIN_R, IMIN_I, IMAX_R, IMAX_I, POPCNT, LZCNT,
+	TZCNT, BSWAP, ROL_R, ROL_I, ROR_R, ROR_I, CRC32, UMULH_R, UMULH_W, TCALL, LCALL, LRET,
+	ENTER, LEAVE, PUSHM, POPM, LDS, STS
+} idlevm_op;
+
+#endif
@@ -0,0 +1,52 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef IDLETRACE_H
+#define IDLETRACE_H
+
+#include <stdint.h>
+
+/*
+	* execution trace written by vm --trace and read by trace:
+	* the header, then one record per traced instruction in the order
+	* they ran, up to the end of the file
+	* EVERY = only every EVERY-th instruction is recorded, RING = the run
+	* kept only its last RING records, TOTAL = records made over the run
+	* REG = the register the instruction wrote and VAL its new value,
+	* IDLETRACE_NOREG when it wrote none
+*/
+
+#define IDLETRACE_MAGIC "IDLT"
+#define IDLETRACE_VERSION 1
+#define IDLETRACE_NOREG 0xff
+
+typedef struct idletrace_hdr {
+	char magic[4];
+	uint32_t version;
+	uint32_t every;
+	uint32_t ring;
+	uint64_t total;
+} idletrace_hdr;
+
+typedef struct idletrace_rec {
+	uint32_t ip;
+	uint16_t op;
+	uint8_t reg;
+	uint8_t pad;
+	uint64_t val;
+} idletrace_rec;
+
+#endif
@@ -0,0 +1,184 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef IDLEVM_H
+#define IDLEVM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <setjmp.h>
+#include <signal.h>
+
+/*
+	* embedding the VM: build src/vm.c with -DIDLEVM_EMBED to leave out its
+	* main, then idlevm_init, idlevm_bind every host function the guest
+	* imports, idlevm_load (or idlevm_link on slots already in memory),
+	* idlevm_run and idlevm_free
+	*
+	* guest memory is one reserved address range: the 64 KiB raw data at
+	* its start and mapped regions from IDLEVM_MAPBASE up, loads and stores reach
+	* both directly, mapped pages are read from their file on first touch
+	*
+	* a host function gets the VM and the code, reads its arguments from
+	* v->regs and leaves its result in v->regs[2] (rtv) like the built-in ones
+	*
+	* a runtime error, int exit or int abort ends the process, unless the
+	* host points v->jmp at a jmp_buf, then it longjmps there with the exit
+	* status in v->status; idlevm_reset readies the VM for the next program
+	*
+	* code translated by aot.exe links against the same runtime and calls
+	* the functions below the embedding API for errors, return stack growth,
+	* crc32 and guest faults
+*/
+
+#define IDLE_REGS_COUNT 64
+#define IDLE_RADRESS_COUNT 1024
+#define IDLE_DEFAULTSTACK 0x6000
+#define IDLE_RADRESS_MAX (UINT64_C(1) << 26)
+
+#define IDLEVM_MAPBASE (UINT64_C(1) << 32)
+#define IDLEVM_MAP_RDONLY 0
+#define IDLEVM_MAP_COW 1
+#define IDLEVM_MAP_FAILED UINT64_MAX
+
+/*
+	* loads, stores and the interrupts that take a guest address stop with
+	* IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS on any address of this or above, it
+	* is the 1 TiB range vm.c reserves, and only the raw data on Windows
+*/
+#if !defined(_WIN32)
+#define IDLEVM_GUESTLIMIT (UINT64_C(1) << 40)
+#else
+#define IDLEVM_GUESTLIMIT UINT64_C(65536)
+#endif
+
+typedef enum idlevm_err {
+	IDLEVM_ERR_SUCCESSFUL_EXIT = 0,
+	IDLEVM_ERR_INCORRECT_OPCODE,
+	IDLEVM_ERR_INCORRECT_ARGUMENT,
+	IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS,
+	IDLEVM_ERR_ALLOCATION_FAILED,
+	IDLEVM_ERR_DIVIDE_BY_ZERO,
+	IDLEVM_ERR_NULL_DEREFERENCE,
+	IDLEVM_ERR_FILE_NOT_READ,
+	IDLEVM_ERR_STACK_OVERFLOW,
+	IDLEVM_ERR_STACK_UNDERFLOW,
+	IDLEVM_ERR_ADRESS_STACK_OVERFLOW,
+	IDLEVM_ERR_ADRESS_STACK_UNDERFLOW,
+	IDLEVM_ERR_INCORRECT_INT_NUMBER,
+	IDLEVM_ERR_UNRESOLVED_IMPORT,
+	IDLEVM_ERR_FILE_NOT_WRITTEN,
+} idlevm_err;
+
+typedef struct idlevm_command {
+	uint16_t op;
+	uint8_t arg1;
+	uint8_t arg2;
+	uint32_t imm;
+} idlevm_command;
+
+typedef struct idle_vm idle_vm;
+typedef struct idlevm_tracer idlevm_tracer;
+typedef struct idlevm_profiler idlevm_profiler;
+
+typedef int (*idlevm_func)(idle_vm *v, idlevm_command *cm);
+
+typedef struct idlevm_native {
+	const char *name;
+	idlevm_func fn;
+} idlevm_native;
+
+typedef struct idlevm_region {
+	uint64_t addr;
+	uint64_t len;
+	int flags;
+} idlevm_region;
+
+struct idle_vm {
+	/*
+		* INTS = dense interrupt table of the loaded program, the built-in
+		* interrupts followed by its imports, NINT entries, none of them NULL
+		* HOST = functions bound by name, the names are not copied
+		* REG = mapped regions in the order they were made, MNEXT = guest
+		* address of the next one
+		* ICOUNT = guest instructions run, kept current at HLT, INT and the end
+		* of idlevm_run, but only while COUNT is set or a trace or profiler is
+		* open: the plain interpreter does not count
+		* COUNT = count instructions without a trace or profiler, set by
+		* idlevm_perfstart
+		* TRACE = open execution trace or NULL, see idlevm_traceopen
+		* PROF = open sampling profiler or NULL, see idlevm_profopen
+		* COMPACT = the linked code is compact words (idlebin.h), the count
+		* idlevm_link returned and idlevm_run takes is then in words
+		* RADRESS = return stack of RADCAP entries, starts at IDLE_RADRESS_COUNT
+		* and doubles when a call reaches the end, up to IDLE_RADRESS_MAX
+		* IN, OUT, ERR = streams of the built-in interrupts and the error
+		* messages, stdin, stdout and stderr after idlevm_init
+		* JMP = where a caught stop goes, STATUS = its exit status
+		* NCODE = slots idlevm_link was given, the bound of int loadid
+		* ININT = an interrupt or host function is running, a fault handler
+		* tells the host's own faults from the guest's by it
+	*/
+	uint64_t regs[IDLE_REGS_COUNT];
+	uint64_t *radress;
+	uint64_t radcap;
+	uint8_t *raw_data;
+	uint64_t *stack;
+	uint64_t mp;
+	idlevm_func *ints;
+	uint32_t nint;
+	idlevm_native *host;
+	uint32_t nhost;
+	idlevm_region *reg;
+	uint32_t nreg;
+	uint64_t mnext;
+	uint64_t icount;
+	int count;
+	idlevm_tracer *trace;
+	idlevm_profiler *prof;
+	int compact;
+	FILE *in;
+	FILE *out;
+	FILE *err;
+	jmp_buf *jmp;
+	int status;
+	uint64_t ncode;
+	volatile sig_atomic_t inint;
+};
+
+void idlevm_init(idle_vm *v);
+int idlevm_bind(idle_vm *v, const char *name, idlevm_func fn);
+size_t idlevm_link(idle_vm *v, idlevm_command *cm, size_t n);
+idlevm_command *idlevm_load(idle_vm *v, const char *path, size_t *n);
+int idlevm_run(idle_vm *v, idlevm_command *cm, size_t n);
+void idlevm_reset(idle_vm *v);
+void idlevm_free(idle_vm *v);
+void idlevm_stop(idle_vm *v, int status);
+uint64_t idlevm_mapfd(idle_vm *v, int fd, uint64_t off, uint64_t len, int flags);
+uint64_t idlevm_mapfile(idle_vm *v, const char *path, int flags);
+void *idlevm_mapbuf(idle_vm *v, uint64_t len, uint64_t *addr);
+int idlevm_traceopen(idle_vm *v, const char *path, uint32_t every, uint32_t ring);
+int idlevm_traceclose(idle_vm *v);
+int idlevm_profopen(idle_vm *v, const char *path, const char *map, uint32_t hz, uint64_t every);
+int idlevm_profclose(idle_vm *v);
+
+void idlevm_logerr(idle_vm *v, int e, const char *msg);
+uint64_t *idlevm_growrad(idle_vm *v, uint64_t need);
+uint64_t idlevm_crc32(uint64_t crc, uint64_t a);
+void idlevm_fault(int sig);
+
+#endif
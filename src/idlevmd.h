@@ -0,0 +1,68 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef IDLEVMD_H
+#define IDLEVMD_H
+
+#include <stdint.h>
+
+/*
+	* protocol of vmd.exe over its Unix socket, any number of requests per
+	* connection, each answered before the next is read
+	* request: the header, NPROG bytes of binary, NIN bytes of stdin
+	* NPROG = 0 runs the cached binary with HASH, the FNV-1a hash of its
+	* bytes (idlevmd_hash), the answer has IDLEVMD_MISS set when the
+	* server does not have it and the client sends the bytes again
+	* response: the header, NOUT bytes of stdout, NERR bytes of stderr
+	* STATUS = what vm.exe would have exited with, HASH = the binary's
+*/
+
+#define IDLEVMD_MAGIC "IDLQ"
+#define IDLEVMD_RMAGIC "IDLR"
+#define IDLEVMD_VERSION 1
+
+#define IDLEVMD_MAXPROG (UINT64_C(8) << 20)
+#define IDLEVMD_MAXIN (UINT64_C(64) << 20)
+
+#define IDLEVMD_MISS 0x01u
+#define IDLEVMD_BAD 0x02u
+
+typedef struct idlevmd_req {
+	char magic[4];
+	uint32_t version;
+	uint64_t hash;
+	uint64_t nprog;
+	uint64_t nin;
+} idlevmd_req;
+
+typedef struct idlevmd_rsp {
+	char magic[4];
+	uint32_t flags;
+	int32_t status;
+	uint32_t pad;
+	uint64_t hash;
+	uint64_t nout;
+	uint64_t nerr;
+} idlevmd_rsp;
+
+static inline uint64_t idlevmd_hash(const void *p, uint64_t n) {
+	const uint8_t *s = (const uint8_t *)p;
+	uint64_t h = UINT64_C(14695981039346656037);
+	for(uint64_t i = 0; i < n; i++) {h = (h ^ s[i]) * UINT64_C(1099511628211);}
+	return h;
+}
+
+#endif
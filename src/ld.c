@@ -0,0 +1,292 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "idleop.h"
+#include "idleobj.h"
+#include "idlebin.h"
+
+#define idleld_error(mac, msg) idleld_logerr(mac, msg)
+
+typedef enum idleld_err {
+	IDLELD_ERR_SUCCESSFUL_EXIT = 0,
+	IDLELD_ERR_FAILED_EXIT,
+	IDLELD_ERR_ALLOCATION_FAILED,
+	IDLELD_ERR_FILE_NOT_READ,
+	IDLELD_ERR_FILE_NOT_WRITTEN,
+	IDLELD_ERR_BAD_OBJECT,
+	IDLELD_ERR_UNDEFINED_SYMBOL,
+	IDLELD_ERR_DUPLICATE_SYMBOL,
+} idleld_err;
+
+typedef struct opsvd_t {
+	uint16_t op;
+	uint8_t arg0;
+	uint8_t arg1;
+	uint32_t imm;
+} opsvd_t;
+
+typedef struct ldfile_t {
+	/*
+		* one loaded object, SEC0 is the index of its first section,
+		* sections of all files are numbered in link order
+	*/
+	const char *path;
+	idleobj_hdr h;
+	opsvd_t *svd;
+	uint8_t *flg;
+	idleobj_sym *sym;
+	idleobj_rel *rel;
+	char *str;
+	unsigned sec0;
+	unsigned nsec;
+} ldfile_t;
+
+typedef struct ldsec_t {
+	/*
+		* a function: the slots from one global label up to the next,
+		* REL..EREL are the relocations inside it
+	*/
+	unsigned file;
+	uint32_t b;
+	uint32_t e;
+	uint32_t rel;
+	uint32_t erel;
+	uint32_t addr;
+	int keep;
+} ldsec_t;
+
+typedef struct ldglobal_t {
+	const char *name;
+	uint32_t len;
+	unsigned file;
+	uint32_t slot;
+} ldglobal_t;
+
+void idleld_logerr(int e, const char *msg) {
+	fprintf(stderr, "[idleld_err] %#.8x, %s\n", e, msg);
+	exit(e);
+}
+
+void *idleld_alloc(size_t n) {
+	void *p = calloc(1, n ? n : 1);
+	if(!p) {idleld_error(IDLELD_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+	return p;
+}
+
+void idleld_read(FILE *f, void *p, size_t sz, size_t n) {
+	if(fread(p, sz, n, f) != n) {idleld_error(IDLELD_ERR_BAD_OBJECT, "object file is truncated");}
+}
+
+int idleld_load(ldfile_t *o, const char *path) {
+	FILE *f = fopen(path, "rb");
+	if(!f) {idleld_error(IDLELD_ERR_FILE_NOT_READ, "failed to read file");}
+	o->path = path;
+	idleld_read(f, &o->h, sizeof(o->h), 1);
+	if(memcmp(o->h.magic, IDLEOBJ_MAGIC, 4) || o->h.version != IDLEOBJ_VERSION) {idleld_error(IDLELD_ERR_BAD_OBJECT, "not an object file");}
+	o->svd = idleld_alloc(o->h.nslot*sizeof(opsvd_t));
+	o->flg = idleld_alloc(o->h.nslot);
+	o->sym = idleld_alloc(o->h.nsym*sizeof(idleobj_sym));
+	o->rel = idleld_alloc(o->h.nrel*sizeof(idleobj_rel));
+	o->str = idleld_alloc(o->h.strsz);
+	idleld_read(f, o->svd, sizeof(opsvd_t), o->h.nslot);
+	idleld_read(f, o->flg, 1, o->h.nslot);
+	idleld_read(f, o->sym, sizeof(idleobj_sym), o->h.nsym);
+	idleld_read(f, o->rel, sizeof(idleobj_rel), o->h.nrel);
+	idleld_read(f, o->str, 1, o->h.strsz);
+	fclose(f);
+	for(uint32_t i = 0; i < o->h.nsym; i++) {
+		if((uint64_t)o->sym[i].name + o->sym[i].len > o->h.strsz) {idleld_error(IDLELD_ERR_BAD_OBJECT, "symbol name out of range");}
+		if((o->sym[i].flags & IDLEOBJ_SYM_DEF) && o->sym[i].slot > o->h.nslot) {idleld_error(IDLELD_ERR_BAD_OBJECT, "symbol slot out of range");}
+	}
+	for(uint32_t i = 0; i < o->h.nrel; i++) {
+		if(o->rel[i].slot >= o->h.nslot || o->rel[i].sym >= o->h.nsym) {idleld_error(IDLELD_ERR_BAD_OBJECT, "relocation out of range");}
+		if(i && o->rel[i].slot < o->rel[i-1].slot) {idleld_error(IDLELD_ERR_BAD_OBJECT, "relocations are not sorted");}
+	}
+	return 0;
+}
+
+int idleld_cmpu32(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+int idleld_cmpglobal(const void *a, const void *b) {
+	const ldglobal_t *x = a, *y = b;
+	if(x->len != y->len) {return x->len < y->len ? -1 : 1;}
+	return memcmp(x->name, y->name, x->len);
+}
+
+unsigned idleld_split(ldfile_t *o, unsigned fi, ldsec_t *sec, unsigned ns) {
+	/* sections start at slot 0 and at every global label */
+	uint32_t *cut = idleld_alloc((o->h.nsym + 2)*sizeof(uint32_t)); unsigned nc = 0, r = 0;
+	cut[nc++] = 0;
+	for(uint32_t i = 0; i < o->h.nsym; i++) {
+		if((o->sym[i].flags & (IDLEOBJ_SYM_DEF | IDLEOBJ_SYM_GLOBAL)) == (IDLEOBJ_SYM_DEF | IDLEOBJ_SYM_GLOBAL)) {cut[nc++] = o->sym[i].slot;}
+	}
+	qsort(cut, nc, sizeof(uint32_t), idleld_cmpu32);
+	cut[nc] = o->h.nslot;
+	o->sec0 = ns;
+	if(!o->h.nslot) {sec[ns].file = fi; sec[ns++].rel = 0;}
+	for(unsigned i = 0; i < nc; i++) {
+		if(cut[i] == cut[i + 1] || cut[i] >= o->h.nslot) {continue;}
+		ldsec_t *s = &sec[ns++];
+		s->file = fi; s->b = cut[i]; s->e = cut[i + 1];
+		while(r < o->h.nrel && o->rel[r].slot < s->b) {r++;}
+		s->rel = r;
+		while(r < o->h.nrel && o->rel[r].slot < s->e) {r++;}
+		s->erel = r;
+	}
+	o->nsec = ns - o->sec0;
+	free(cut);
+	return ns;
+}
+
+unsigned idleld_secof(ldfile_t *o, ldsec_t *sec, uint32_t slot) {
+	/* a label on the last slot of a file belongs to the section before it */
+	unsigned lo = o->sec0, hi = o->sec0 + o->nsec - 1;
+	while(lo < hi) {
+		unsigned m = (lo + hi + 1) / 2;
+		if(sec[m].b <= slot) {lo = m;} else {hi = m - 1;}
+	}
+	return lo;
+}
+
+int idleld_resolve(ldfile_t *f, ldglobal_t *g, unsigned ng, unsigned fi, uint32_t si, unsigned *tf, uint32_t *ts) {
+	/* a label of the same file wins, otherwise a global of any file */
+	idleobj_sym *y = &f[fi].sym[si];
+	ldglobal_t k, *r;
+	if(y->flags & IDLEOBJ_SYM_DEF) {*tf = fi; *ts = y->slot; return 1;}
+	k.name = &f[fi].str[y->name]; k.len = y->len;
+	r = bsearch(&k, g, ng, sizeof(ldglobal_t), idleld_cmpglobal);
+	if(!r) {
+		fprintf(stderr, "[idleld_err] %s: undefined symbol %.*s\n", f[fi].path, (int)y->len, k.name);
+		idleld_error(IDLELD_ERR_UNDEFINED_SYMBOL, "undefined symbol");
+	}
+	*tf = r->file; *ts = r->slot;
+	return 1;
+}
+
+int idleld_falls(ldfile_t *o, ldsec_t *s) {
+	/* the last instruction of a section runs into the next one unless it jumps away */
+	for(uint32_t i = s->e; i > s->b; i--) {
+		if(o->flg[i - 1] & IDLEOBJ_SLOT_DATA) {continue;}
+		uint16_t op = o->svd[i - 1].op;
+		return !(op == JMP || op == RET || op == HLT || op == TCALL || op == LRET);
+	}
+	return 1;
+}
+
+int idleld_main(int argc, char **argv) {
+	/*
+		* ld.exe program.bin a.o b.o ... [--no-strip]
+		* execution starts at the first slot of the first object, sections
+		* not reachable from it through relocations or fall-through are dropped
+	*/
+	const char *fout = NULL; int strip = 1; unsigned nf = 0, ns = 0, ng = 0, nslot = 0, nsym = 0;
+	ldfile_t *f = idleld_alloc(argc*sizeof(ldfile_t));
+
+	for(int a = 1; a < argc; a++) {
+		if(!strcmp(argv[a], "--no-strip")) {strip = 0;}
+		else if(!fout) {fout = argv[a];}
+		else {idleld_load(&f[nf++], argv[a]);}
+	}
+
+	if(!fout || !nf) {return 1;}
+
+	for(unsigned i = 0; i < nf; i++) {nslot += f[i].h.nslot; nsym += f[i].h.nsym;}
+
+	ldsec_t *sec = idleld_alloc((nslot + nf)*sizeof(ldsec_t));
+	ldglobal_t *g = idleld_alloc(nsym*sizeof(ldglobal_t));
+	unsigned *wl = idleld_alloc((nslot + nf)*sizeof(unsigned));
+
+	for(unsigned i = 0; i < nf; i++) {
+		ns = idleld_split(&f[i], i, sec, ns);
+		for(uint32_t k = 0; k < f[i].h.nsym; k++) {
+			idleobj_sym *y = &f[i].sym[k];
+			if((y->flags & (IDLEOBJ_SYM_DEF | IDLEOBJ_SYM_GLOBAL)) != (IDLEOBJ_SYM_DEF | IDLEOBJ_SYM_GLOBAL)) {continue;}
+			g[ng].name = &f[i].str[y->name]; g[ng].len = y->len; g[ng].file = i; g[ng++].slot = y->slot;
+		}
+		/* a program that reads its own code through loadid must keep every slot in place */
+		for(uint32_t k = 0; k < f[i].h.nslot; k++) {
+			if(!(f[i].flg[k] & IDLEOBJ_SLOT_DATA) && f[i].svd[k].op == INT && f[i].svd[k].imm == IDLEBIN_INTLOADID) {strip = 0;}
+		}
+	}
+
+	qsort(g, ng, sizeof(ldglobal_t), idleld_cmpglobal);
+	for(unsigned i = 1; i < ng; i++) {
+		if(!idleld_cmpglobal(&g[i - 1], &g[i])) {
+			fprintf(stderr, "[idleld_err] duplicate symbol %.*s\n", (int)g[i].len, g[i].name);
+			idleld_error(IDLELD_ERR_DUPLICATE_SYMBOL, "duplicate symbol");
+		}
+	}
+
+	unsigned nw = 0;
+	for(unsigned i = 0; i < ns; i++) {sec[i].keep = !strip;}
+	if(ns) {sec[0].keep = 1; wl[nw++] = 0;}
+	while(nw) {
+		ldsec_t *s = &sec[wl[--nw]]; unsigned tf, t; uint32_t ts;
+		for(uint32_t r = s->rel; r < s->erel; r++) {
+			idleld_resolve(f, g, ng, s->file, f[s->file].rel[r].sym, &tf, &ts);
+			t = idleld_secof(&f[tf], sec, ts);
+			if(!sec[t].keep) {sec[t].keep = 1; wl[nw++] = t;}
+		}
+		t = (unsigned)(s - sec) + 1;
+		if(t < ns && !sec[t].keep && idleld_falls(&f[s->file], s)) {sec[t].keep = 1; wl[nw++] = t;}
+	}
+
+	uint32_t addr = 0;
+	for(unsigned i = 0; i < ns; i++) {
+		if(!sec[i].keep) {continue;}
+		sec[i].addr = addr;
+		addr += sec[i].e - sec[i].b;
+	}
+
+	opsvd_t *out = idleld_alloc(addr*sizeof(opsvd_t));
+	for(unsigned i = 0; i < ns; i++) {
+		ldsec_t *s = &sec[i]; ldfile_t *o = &f[s->file]; unsigned tf, t; uint32_t ts;
+		if(!s->keep) {continue;}
+		memcpy(&out[s->addr], &o->svd[s->b], (s->e - s->b)*sizeof(opsvd_t));
+		for(uint32_t r = s->rel; r < s->erel; r++) {
+			uint32_t at = s->addr + o->rel[r].slot - s->b;
+			idleld_resolve(f, g, ng, s->file, o->rel[r].sym, &tf, &ts);
+			t = idleld_secof(&f[tf], sec, ts);
+			/* a label past the last slot of a file points behind its last section */
+			int64_t to = (int64_t)sec[t].addr + ts - sec[t].b;
+			out[at].imm = (uint32_t)(int32_t)(to - (int64_t)at - 1);
+		}
+	}
+
+	FILE *fo = fopen(fout, "wb");
+	if(!fo) {idleld_error(IDLELD_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	if(fwrite(out, sizeof(opsvd_t), addr, fo) != addr) {idleld_error(IDLELD_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+	if(fclose(fo)) {idleld_error(IDLELD_ERR_FILE_NOT_WRITTEN, "failed to write file");}
+
+	for(unsigned i = 0; i < nf; i++) {
+		free(f[i].svd); free(f[i].flg); free(f[i].sym); free(f[i].rel); free(f[i].str);
+	}
+	free(out); free(wl); free(g); free(sec); free(f);
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	return idleld_main(argc, argv);
+}
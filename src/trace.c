@@ -0,0 +1,275 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "idleop.h"
+#include "idletrace.h"
+
+#define idletr_error(mac, msg) idletr_logerr(mac, msg)
+
+#define arraysize(a) (sizeof(a)/sizeof(a[0]))
+
+#define IDLETR_TOP 16
+
+typedef enum idletr_err {
+	IDLETR_ERR_SUCCESSFUL_EXIT = 0,
+	IDLETR_ERR_FAILED_EXIT,
+	IDLETR_ERR_ALLOCATION_FAILED,
+	IDLETR_ERR_FILE_NOT_READ,
+	IDLETR_ERR_BAD_TRACE,
+	IDLETR_ERR_BAD_MAP,
+	IDLETR_ERR_UNKNOWN_NAME,
+} idletr_err;
+
+/* mnemonics in idlevm_op order, the _R/_I/_W forms share one */
+const char *idletr_op[] = {
+	"hlt", "nop", "add", "add", "sub", "sub", "rsb", "rsb", "mul", "mul", "div", "div", "rdv", "rdv", "mod", "mod", "rmd", "rmd", "imul", "imul", "idiv",
+	"idiv", "irdv", "irdv", "and", "and", "or", "or", "xor", "xor", "not", "shr", "shr", "shl", "shl", "mov", "mov", "xchg", "cmp", "cmp", "jmp", "je", "jl", "jg", "jle",
+	"jge", "jne", "int", "push", "pop", "asr", "asr", "bt", "bt", "bts", "bts", "btr", "btr", "bti", "bti", "call", "ret", "ldb", "ldb", "lddb", "lddb", "ldqb", "ldqb",
+	"stb", "stb", "stdb", "stdb", "stqb", "stqb", "mov", "je", "je", "jl", "jl", "jg", "jg", "jle", "jle", "jge", "jge", "jne", "jne",
+	"loop", "cmove", "cmove", "cmovl", "cmovl", "cmovg", "cmovg", "cmovle", "cmovle", "cmovge", "cmovge", "cmovne", "cmovne", "sete", "setl",
+	"setg", "setle", "setge", "setne", "min", "min", "max", "max", "imin", "imin", "imax", "imax", "popcnt", "lzcnt",
+	"tzcnt", "bswap", "rol", "rol", "ror", "ror", "crc32", "umulh", "umulh", "tcall", "lcall", "lret",
+	"enter", "leave", "pushm", "popm", "lds", "sts"
+};
+
+typedef char idletr_opcheck[arraysize(idletr_op) == STS + 1 ? 1 : -1];
+
+const char *idletr_reg[] = {
+	"atr0", "atr1", "rtv", "rta", "rg0", "rg1", "rg2", "rg3", "sp", "rtaa", "fp", "t0",
+	"t1", "t2", "t3", "t4", "t5", "t6", "t7", "t8", "t9", "t10", "t11", "t12",
+	"s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11",
+	"p0", "p1", "p2", "p3", "p4", "p5", "p6", "p7", "xh", "xl", "yh", "yl", "zh", "zl"
+};
+
+typedef struct trlabel_t {
+	char *name;
+	uint32_t slot;
+} trlabel_t;
+
+typedef struct trmap_t {
+	/* labels sorted by slot, LIN[i] is the source line from slot LSLOT[i] on */
+	trlabel_t *lbl;
+	uint32_t nlbl;
+	uint32_t *lslot, *lin;
+	uint32_t nlin;
+} trmap_t;
+
+typedef struct trcount_t {
+	uint32_t key;
+	uint64_t n;
+} trcount_t;
+
+void idletr_logerr(int e, const char *msg) {
+	fprintf(stderr, "[idletr_err] %#.8x, %s\n", e, msg);
+	exit(e);
+}
+
+void *idletr_alloc(size_t n) {
+	void *p = calloc(1, n ? n : 1);
+	if(!p) {idletr_error(IDLETR_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+	return p;
+}
+
+void *idletr_grow(void *p, size_t n) {
+	p = realloc(p, n ? n : 1);
+	if(!p) {idletr_error(IDLETR_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+	return p;
+}
+
+int idletr_lblcmp(const void *a, const void *b) {
+	uint32_t x = ((const trlabel_t *)a)->slot, y = ((const trlabel_t *)b)->slot;
+	return x < y ? -1 : x > y;
+}
+
+int idletr_cntcmp(const void *a, const void *b) {
+	uint64_t x = ((const trcount_t *)a)->n, y = ((const trcount_t *)b)->n;
+	return x > y ? -1 : x < y;
+}
+
+void idletr_loadmap(trmap_t *m, const char *path) {
+	/* the -g map of asm: label <name> <slot> and line <slot> <line> */
+	char ln[4096], name[4096]; unsigned a, b; uint32_t cl = 0, cn = 0;
+	FILE *f = fopen(path, "r");
+	if(!f) {idletr_error(IDLETR_ERR_FILE_NOT_READ, "failed to read file");}
+	if(!fgets(ln, sizeof(ln), f) || strncmp(ln, "idledbg 1", 9)) {idletr_error(IDLETR_ERR_BAD_MAP, "not a debug map");}
+	while(fgets(ln, sizeof(ln), f)) {
+		if(sscanf(ln, "label %4095s %u", name, &a) == 2) {
+			if(m->nlbl == cl) {cl = cl ? cl*2 : 64; m->lbl = idletr_grow(m->lbl, cl*sizeof(trlabel_t));}
+			m->lbl[m->nlbl].name = idletr_alloc(strlen(name) + 1);
+			strcpy(m->lbl[m->nlbl].name, name);
+			m->lbl[m->nlbl++].slot = a;
+		} else if(sscanf(ln, "line %u %u", &a, &b) == 2) {
+			if(m->nlin == cn) {cn = cn ? cn*2 : 256; m->lslot = idletr_grow(m->lslot, cn*sizeof(uint32_t)); m->lin = idletr_grow(m->lin, cn*sizeof(uint32_t));}
+			if(m->nlin && a < m->lslot[m->nlin - 1]) {idletr_error(IDLETR_ERR_BAD_MAP, "line entries are not sorted");}
+			m->lslot[m->nlin] = a;
+			m->lin[m->nlin++] = b;
+		}
+	}
+	fclose(f);
+	if(m->nlbl) {qsort(m->lbl, m->nlbl, sizeof(trlabel_t), idletr_lblcmp);}
+}
+
+int64_t idletr_find(const uint32_t *s, size_t sz, uint32_t n, uint32_t ip) {
+	/* last entry whose slot is at most IP, -1 before the first one */
+	int64_t lo = 0, hi = (int64_t)n - 1, r = -1;
+	while(lo <= hi) {
+		int64_t md = (lo + hi) / 2;
+		if(*(const uint32_t *)((const char *)s + md*sz) <= ip) {r = md; lo = md + 1;} else {hi = md - 1;}
+	}
+	return r;
+}
+
+int64_t idletr_label(const trmap_t *m, uint32_t ip) {
+	return m->nlbl ? idletr_find(&m->lbl[0].slot, sizeof(trlabel_t), m->nlbl, ip) : -1;
+}
+
+int idletr_where(char *o, size_t sz, const trmap_t *m, uint32_t ip) {
+	/* label+offset and source line of IP, as much as the map knows */
+	int64_t l = idletr_label(m, ip), k = m->nlin ? idletr_find(m->lslot, sizeof(uint32_t), m->nlin, ip) : -1;
+	int r = 0;
+	if(l >= 0) {r = snprintf(o, sz, "%s+%u", m->lbl[l].name, ip - m->lbl[l].slot);} else if(sz) {o[0] = 0;}
+	if(k >= 0 && r >= 0 && (size_t)r < sz) {snprintf(o + r, sz - r, "%sline %u", r ? " " : "", m->lin[k]);}
+	return 0;
+}
+
+const char *idletr_opname(uint16_t op) {
+	return op < arraysize(idletr_op) ? idletr_op[op] : "?";
+}
+
+int idletr_regnum(const char *s) {
+	for(unsigned i = 0; i < arraysize(idletr_reg); i++) {if(!strcmp(s, idletr_reg[i])) {return (int)i;}}
+	if(s[0] == 'y' && s[1] >= '0' && s[1] <= '9') {return atoi(s + 1);}
+	return -1;
+}
+
+void idletr_regname(char *o, size_t sz, uint8_t r) {
+	if(r < arraysize(idletr_reg)) {snprintf(o, sz, "%s", idletr_reg[r]);} else {snprintf(o, sz, "y%u", (unsigned)r);}
+}
+
+void idletr_count(trcount_t **c, uint32_t *n, uint32_t *cap, uint32_t key, uint64_t inc) {
+	/* counters kept sorted by key for lookup */
+	int64_t i = *n ? idletr_find(&(*c)[0].key, sizeof(trcount_t), *n, key) : -1;
+	if(i >= 0 && (*c)[i].key == key) {(*c)[i].n += inc; return;}
+	if(*n == *cap) {*cap = *cap ? *cap*2 : 256; *c = idletr_grow(*c, *cap*sizeof(trcount_t));}
+	memmove(&(*c)[i + 2], &(*c)[i + 1], (*n - (i + 1))*sizeof(trcount_t));
+	(*c)[i + 1].key = key; (*c)[i + 1].n = inc;
+	(*n)++;
+}
+
+void idletr_top(const char *title, trcount_t *c, uint32_t n, const trmap_t *m, int ops) {
+	char w[512];
+	if(!n) {return;}
+	qsort(c, n, sizeof(trcount_t), idletr_cntcmp);
+	printf("%s\n", title);
+	for(uint32_t i = 0; i < n && i < IDLETR_TOP; i++) {
+		if(ops) {snprintf(w, sizeof(w), "%s", idletr_opname((uint16_t)c[i].key));}
+		else {idletr_where(w, sizeof(w), m, c[i].key); if(!w[0]) {snprintf(w, sizeof(w), "%u", c[i].key);}}
+		printf("%14llu  %s\n", (unsigned long long)c[i].n, w);
+	}
+}
+
+int idletr_main(int argc, char **argv) {
+	/*
+		* trace.exe run.trace [-g program.map] [-s] [-o op] [-r reg] [-l label] [-n count]
+		* prints the records that pass every filter, -s a summary instead:
+		* opcode and label histograms, and with an unsampled trace the
+		* call targets and the taken backward branches with their counts
+	*/
+	const char *fin = NULL, *fmap = NULL, *fop = NULL, *flbl = NULL; int sum = 0, freg = -1;
+	uint64_t lim = UINT64_MAX, shown = 0, nrec = 0;
+	trmap_t m; memset(&m, 0, sizeof(m));
+
+	for(int a = 1; a < argc; a++) {
+		if(a + 1 < argc && !strcmp(argv[a], "-g")) {fmap = argv[++a];}
+		else if(a + 1 < argc && !strcmp(argv[a], "-o")) {fop = argv[++a];}
+		else if(a + 1 < argc && !strcmp(argv[a], "-r")) {if((freg = idletr_regnum(argv[++a])) < 0) {idletr_error(IDLETR_ERR_UNKNOWN_NAME, "unknown register");}}
+		else if(a + 1 < argc && !strcmp(argv[a], "-l")) {flbl = argv[++a];}
+		else if(a + 1 < argc && !strcmp(argv[a], "-n")) {lim = strtoull(argv[++a], NULL, 10);}
+		else if(!strcmp(argv[a], "-s")) {sum = 1;}
+		else {fin = argv[a];}
+	}
+	if(!fin) {return 1;}
+	if(fmap) {idletr_loadmap(&m, fmap);}
+
+	int64_t lsel = -1;
+	if(flbl) {
+		for(uint32_t i = 0; i < m.nlbl; i++) {if(!strcmp(m.lbl[i].name, flbl)) {lsel = i; break;}}
+		if(lsel < 0) {idletr_error(IDLETR_ERR_UNKNOWN_NAME, "unknown label");}
+	}
+
+	FILE *f = fopen(fin, "rb");
+	idletrace_hdr h;
+	if(!f) {idletr_error(IDLETR_ERR_FILE_NOT_READ, "failed to read file");}
+	if(fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, IDLETRACE_MAGIC, 4) || h.version != IDLETRACE_VERSION) {idletr_error(IDLETR_ERR_BAD_TRACE, "not a trace file");}
+
+	trcount_t *cop = NULL, *clb = NULL, *ccall = NULL, *cback = NULL;
+	uint32_t nop = 0, nlb = 0, ncall = 0, nback = 0, kop = 0, klb = 0, kcall = 0, kback = 0;
+	idletrace_rec buf[4096], prev; size_t got; int hasprev = 0;
+	char w[512], rn[16]; uint16_t canon[arraysize(idletr_op)];
+
+	/* the opcode histogram counts forms of one mnemonic together */
+	for(uint16_t i = 0; i < arraysize(idletr_op); i++) {
+		canon[i] = i;
+		for(uint16_t k = 0; k < i; k++) {if(!strcmp(idletr_op[k], idletr_op[i])) {canon[i] = k; break;}}
+	}
+
+	while((got = fread(buf, sizeof(idletrace_rec), arraysize(buf), f)) > 0) {
+		for(size_t i = 0; i < got; i++) {
+			idletrace_rec *r = &buf[i];
+			int64_t l = idletr_label(&m, r->ip);
+			if(sum) {
+				/* consecutive records are consecutive instructions only when nothing was sampled away */
+				if(hasprev && h.every == 1) {
+					if(prev.op == CALL || prev.op == TCALL || prev.op == LCALL) {idletr_count(&ccall, &ncall, &kcall, r->ip, 1);}
+					else if(r->ip <= prev.ip && prev.op != RET && prev.op != LRET) {idletr_count(&cback, &nback, &kback, prev.ip, 1);}
+				}
+				idletr_count(&cop, &nop, &kop, r->op < arraysize(canon) ? canon[r->op] : r->op, 1);
+				if(l >= 0) {idletr_count(&clb, &nlb, &klb, m.lbl[l].slot, 1);}
+				prev = *r; hasprev = 1; nrec++;
+				continue;
+			}
+			nrec++;
+			if(fop && strcmp(fop, idletr_opname(r->op))) {continue;}
+			if(freg >= 0 && r->reg != freg) {continue;}
+			if(lsel >= 0 && l != lsel) {continue;}
+			if(shown++ >= lim) {break;}
+			idletr_where(w, sizeof(w), &m, r->ip);
+			printf("%10llu %8u  %-24s %-7s", (unsigned long long)(nrec - 1), r->ip, w, idletr_opname(r->op));
+			if(r->reg != IDLETRACE_NOREG) {idletr_regname(rn, sizeof(rn), r->reg); printf(" %s=0x%llx", rn, (unsigned long long)r->val);}
+			putchar('\n');
+		}
+		if(shown > lim) {break;}
+	}
+	fclose(f);
+
+	if(sum) {
+		printf("records %llu of %llu, every %u instruction(s)%s\n", (unsigned long long)nrec, (unsigned long long)h.total, h.every, h.ring ? ", ring" : "");
+		idletr_top("opcodes:", cop, nop, &m, 1);
+		idletr_top("labels:", clb, nlb, &m, 0);
+		idletr_top("call targets:", ccall, ncall, &m, 0);
+		idletr_top("taken backward branches:", cback, nback, &m, 0);
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	return idletr_main(argc, argv);
+}
@@ -14,19 +14,57 @@ Copyright 2025 nightmilkyway
    limitations under the License.
 */
 
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <limits.h>
 #include <time.h>
+#include <setjmp.h>
+#include <signal.h>
+
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "idleop.h"
+#include "idlebin.h"
+#include "idlevm.h"
+#include "idletrace.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define IDLE_X86 1
+#endif
 
-#define IDLE_REGS_COUNT 64
-#define IDLE_DEFAULTSTACK 0x6000
 #define IDLE_FILESIZE 0x100000
-#define IDLE_VMINTSIZE 65536
-#define IDLE_RADRESS_COUNT 1024
 #define IDLE_RAWDATASIZE 65536
+#define IDLE_GUESTSPACE (UINT64_C(1) << 40)
+#define IDLE_MAPALIGN 65536
+
+#if defined(__GNUC__)
+#define IDLE_INLINE static inline __attribute__((always_inline))
+#define IDLE_UNLIKELY(c) __builtin_expect(!!(c), 0)
+#else
+#define IDLE_INLINE static inline
+#define IDLE_UNLIKELY(c) (c)
+#endif
 
 #define arraysize(a) (sizeof(a)/sizeof(a[0]))
 
@@ -39,104 +77,201 @@ Copyright 2025 nightmilkyway
 #define BITINVERT(a, i) (a ^ (1 << (i & 0x3f)))
 #define BITRESET(a, i) (a & ~(1 << (i & 0x3f)))
 
-typedef enum idlevm_err {
-	IDLEVM_ERR_SUCCESSFUL_EXIT = 0,
-	IDLEVM_ERR_INCORRECT_OPCODE,
-	IDLEVM_ERR_INCORRECT_ARGUMENT,
-	IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS,
-	IDLEVM_ERR_ALLOCATION_FAILED,
-	IDLEVM_ERR_DIVIDE_BY_ZERO,
-	IDLEVM_ERR_NULL_DEREFERENCE,
-	IDLEVM_ERR_FILE_NOT_READ,
-	IDLEVM_ERR_STACK_OVERFLOW,
-	IDLEVM_ERR_STACK_UNDERFLOW,
-	IDLEVM_ERR_ADRESS_STACK_OVERFLOW,
-	IDLEVM_ERR_ADRESS_STACK_UNDERFLOW,
-	IDLEVM_ERR_INCORRECT_INT_NUMBER,
-} idlevm_err;
-
-typedef enum idlevm_op {
-	HLT=0, NOP, ADD_R, ADD_I, SUB_R, SUB_I, RSB_R, RSB_I, MUL_R, MUL_I, DIV_R, DIV_I, RDV_R, RDV_I, MOD_R, MOD_I, RMD_R, RMD_I, IMUL_R, IMUL_I, IDIV_R,
-	IDIV_I, IRDV_R, IRDV_I, AND_R, AND_I, OR_R, OR_I, XOR_R, XOR_I, NOT_R, SHR_R, SHR_I, SHL_R, SHL_I, MOV_R, MOV_I, XCHG, CMP_R, CMP_I, JMP, JE, JL, JG, JLE,
-	JGE, JNE, INT, PUSH, POP, ASR_R, ASR_I, BT_R, BT_I, BTS_R, BTS_I, BTR_R, BTR_I, BTI_R, BTI_I, CALL, RET, LDB_R, LDB_I, LDDB_R, LDDB_I, LDQB_R, LDQB_I,
-	STB_R, STB_I, STDB_R, STDB_I, STQB_R, STQB_I
-} idlevm_op;
-
-typedef struct idlevm_command {
-	uint16_t op;
-	uint8_t arg1;
-	uint8_t arg2;
-	uint32_t imm;
-} idlevm_command;
-
-typedef struct idle_vm {
-	uint64_t regs[IDLE_REGS_COUNT];
-	uint64_t radress[IDLE_RADRESS_COUNT];
-	uint8_t *raw_data;
-	uint64_t *stack;
-	uint64_t mp;
-} idle_vm;
-
-typedef int (*idlevm_func)(idle_vm *v, idlevm_command *cm);
+#define CMPFLAGS(a, b) ((a) > (b) ? 0x2 : ((a) < (b) ? 0x4 : 0x1))
+#define JMPMASK(f, m) (!!((f) & (m)) - 1)
+#define CCMASK(f, m) (-(uint64_t)!!((f) & (m)))
+#define SELECT(c, a, b) (((a) & ~(c)) | ((b) & (c)))
+#define ROL(a, i) (((a) << ((i) & 0x3f)) | ((a) >> (-(i) & 0x3f)))
+#define ROR(a, i) (((a) >> ((i) & 0x3f)) | ((a) << (-(i) & 0x3f)))
+
+__extension__ typedef unsigned __int128 idle_u128;
+
+void idlevm_stop(idle_vm *v, int status) {
+	/* ends the run with STATUS, the process exit code unless the host catches it in JMP */
+	if(v->jmp) {v->status = status; longjmp(*v->jmp, 1);}
+	exit(status);
+}
 
 int idlevmint_exit(idle_vm *v, idlevm_command *cm) {
-	exit(v->regs[4]);
+	idlevm_stop(v, (int)(v->regs[4] & 0xff)); return 0;
 }
 
 int idlevmint_abort(idle_vm *v, idlevm_command *cm) {
+	/* a caught abort reports what a shell shows for a process killed by SIGABRT */
+	if(v->jmp) {idlevm_stop(v, 128 + SIGABRT);}
 	abort();
 }
 
 int idlevmint_readc(idle_vm *v, idlevm_command *cm) {
-	v->regs[2] = getc(stdin); return 0;
+	v->regs[2] = getc(v->in); return 0;
 }
 
 int idlevmint_writec(idle_vm *v, idlevm_command *cm) {
-	putc(v->regs[4], stdout); return 0;
+	putc(v->regs[4], v->out); return 0;
+}
+
+uint64_t idlevm_span(idle_vm *v, uint64_t a, int wr) {
+	/*
+		* bytes from guest address A to the end of the raw data or the region
+		* holding it, 0 when A is in neither or WR and the region is read-only;
+		* interrupts check their guest addresses here before libc touches them
+	*/
+	if(a < IDLE_RAWDATASIZE) {return IDLE_RAWDATASIZE - a;}
+	for(uint32_t i = 0; i < v->nreg; i++) {
+		idlevm_region *r = &v->reg[i];
+		if(a >= r->addr && a - r->addr < r->len) {return !wr || r->flags ? r->addr + r->len - a : 0;}
+	}
+	return 0;
+}
+
+const char *idlevm_str(idle_vm *v, uint64_t a) {
+	/* the NUL-terminated string at guest address A, stops the run when it does not end inside its region */
+	uint64_t n = idlevm_span(v, a, 0);
+	if(!n || !memchr(&v->raw_data[a], 0, n)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+	return (const char *)&v->raw_data[a];
 }
 
 int idlevmint_vmloadstack(idle_vm *v, idlevm_command *cm) {
+	if(v->regs[4] >= (v->mp - 1) * IDLE_DEFAULTSTACK) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
 	v->regs[2] = (uint64_t)v->stack[v->regs[4]]; return 0;
 }
 
 int idlevmint_vmloadastack(idle_vm *v, idlevm_command *cm) {
+	if(v->regs[4] >= v->radcap) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
 	v->regs[2] = (uint64_t)v->radress[v->regs[4]]; return 0;
 }
 
 int idlevmint_vmloaddata(idle_vm *v, idlevm_command *cm) {
+	if(v->regs[4] >= v->ncode) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
 	v->regs[2] = ((uint64_t *)cm)[v->regs[4]]; return 0;
 }
 
 int idlevmint_writes(idle_vm *v, idlevm_command *cm) {
-	fputs((char *)&v->raw_data[v->regs[4]], stdout); return 0;
+	fputs(idlevm_str(v, v->regs[4]), v->out); return 0;
 }
 
 int idlevmint_reads(idle_vm *v, idlevm_command *cm) {
-	fgets((char *)&v->raw_data[v->regs[4]], v->regs[5], stdin); return 0;
+	/* rg1 bytes at most, the NUL included, into writable guest memory at rg0 */
+	uint64_t n = v->regs[5] < INT_MAX ? v->regs[5] : INT_MAX;
+	if(n && idlevm_span(v, v->regs[4], 1) < n) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+	fgets((char *)&v->raw_data[v->regs[4]], (int)n, v->in); return 0;
 }
 
 int idlevmint_writen(idle_vm *v, idlevm_command *cm) {
-	fprintf(stdout, "%lli", v->regs[4]); return 0;
+	fprintf(v->out, "%lli", v->regs[4]); return 0;
 }
 
 int idlevmint_readn(idle_vm *v, idlevm_command *cm) {
-	fscanf(stdin, "%lli", &v->regs[2]); return 0;
-}
-
-static const idlevm_func idle_vmint[IDLE_VMINTSIZE] = {
-	idlevmint_exit,
-	idlevmint_abort,
-	idlevmint_readc,
-	idlevmint_writec,
-	idlevmint_vmloadstack,
-	idlevmint_vmloadastack,
-	idlevmint_vmloaddata,
-	idlevmint_writes,
-	idlevmint_reads,
-	idlevmint_writen,
-	idlevmint_readn
+	fscanf(v->in, "%lli", &v->regs[2]); return 0;
+}
+
+int idlevmint_mapf(idle_vm *v, idlevm_command *cm) {
+	/* maps the file named at raw address rg0, rg1 = 0 read-only, 1 copy-on-write, rtv = guest address or all ones */
+	v->regs[2] = idlevm_mapfile(v, idlevm_str(v, v->regs[4]), (int)(v->regs[5] & IDLEVM_MAP_COW)); return 0;
+}
+
+int idlevmint_mapinfo(idle_vm *v, idlevm_command *cm) {
+	/* rtv = guest address and rg1 = length of region rg0, rtv = all ones past the last one */
+	uint64_t k = v->regs[4];
+	v->regs[2] = k < v->nreg ? v->reg[k].addr : IDLEVM_MAP_FAILED;
+	v->regs[5] = k < v->nreg ? v->reg[k].len : 0;
+	return 0;
+}
+
+/* built-in interrupts, numbered as the assembler numbers them */
+static const idlevm_native idle_vmint[IDLEBIN_INTCOUNT] = {
+	{"exit", idlevmint_exit},
+	{"abort", idlevmint_abort},
+	{"readc", idlevmint_readc},
+	{"writec", idlevmint_writec},
+	{"loadsd", idlevmint_vmloadstack},
+	{"loadad", idlevmint_vmloadastack},
+	{"loadid", idlevmint_vmloaddata},
+	{"writes", idlevmint_writes},
+	{"reads", idlevmint_reads},
+	{"writen", idlevmint_writen},
+	{"readn", idlevmint_readn},
+	{"mapf", idlevmint_mapf},
+	{"mapinfo", idlevmint_mapinfo}
 };
 
+typedef uint64_t (*idlevm_bitop)(uint64_t a);
+typedef uint64_t (*idlevm_crcop)(uint64_t crc, uint64_t a);
+
+static uint32_t idle_crctable[256];
+
+uint64_t idlevm_popcnt_sw(uint64_t a) {
+	a = a - ((a >> 1) & UINT64_C(0x5555555555555555));
+	a = (a & UINT64_C(0x3333333333333333)) + ((a >> 2) & UINT64_C(0x3333333333333333));
+	a = (a + (a >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+	return (a * UINT64_C(0x0101010101010101)) >> 56;
+}
+
+uint64_t idlevm_lzcnt_sw(uint64_t a) {
+	uint64_t n = 0;
+	if(!a) {return 64;}
+	while(!(a & UINT64_C(0x8000000000000000))) {a <<= 1; n++;}
+	return n;
+}
+
+uint64_t idlevm_tzcnt_sw(uint64_t a) {
+	uint64_t n = 0;
+	if(!a) {return 64;}
+	while(!(a & 1)) {a >>= 1; n++;}
+	return n;
+}
+
+uint64_t idlevm_crc32_sw(uint64_t crc, uint64_t a) {
+	uint32_t c = (uint32_t)crc;
+	for(int i = 0; i < 8; i++, a >>= 8) {
+		c = idle_crctable[(c ^ a) & 0xff] ^ (c >> 8);
+	}
+	return c;
+}
+
+#ifdef IDLE_X86
+__attribute__((target("popcnt"))) uint64_t idlevm_popcnt_hw(uint64_t a) {
+	return (uint64_t)__builtin_popcountll(a);
+}
+
+__attribute__((target("lzcnt"))) uint64_t idlevm_lzcnt_hw(uint64_t a) {
+	return _lzcnt_u64(a);
+}
+
+__attribute__((target("bmi"))) uint64_t idlevm_tzcnt_hw(uint64_t a) {
+	return _tzcnt_u64(a);
+}
+
+__attribute__((target("sse4.2"))) uint64_t idlevm_crc32_hw(uint64_t crc, uint64_t a) {
+	return _mm_crc32_u64((uint32_t)crc, a);
+}
+#endif
+
+static idlevm_bitop idle_popcnt = idlevm_popcnt_sw;
+static idlevm_bitop idle_lzcnt = idlevm_lzcnt_sw;
+static idlevm_bitop idle_tzcnt = idlevm_tzcnt_sw;
+static idlevm_crcop idle_crc32 = idlevm_crc32_sw;
+
+uint64_t idlevm_crc32(uint64_t crc, uint64_t a) {
+	return idle_crc32(crc, a);
+}
+
+void idlevm_bitops_init(void) {
+	/* CRC32 is CRC-32C (Castagnoli), the polynomial of the SSE4.2 crc32 instruction */
+	for(uint32_t i = 0; i < 256; i++) {
+		uint32_t c = i;
+		for(int k = 0; k < 8; k++) {c = (c >> 1) ^ (UINT32_C(0x82f63b78) & -(c & 1));}
+		idle_crctable[i] = c;
+	}
+#ifdef IDLE_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("popcnt")) {idle_popcnt = idlevm_popcnt_hw;}
+	if(__builtin_cpu_supports("lzcnt")) {idle_lzcnt = idlevm_lzcnt_hw;}
+	if(__builtin_cpu_supports("bmi")) {idle_tzcnt = idlevm_tzcnt_hw;}
+	if(__builtin_cpu_supports("sse4.2")) {idle_crc32 = idlevm_crc32_hw;}
+#endif
+}
+
 uint64_t clockCycleCount()
 {
 	unsigned hi, lo;
@@ -145,8 +280,8 @@ uint64_t clockCycleCount()
 }
 
 void idlevm_logerr(idle_vm *v, int e, const char *msg) {
-	fprintf(stderr, "[idle_err] %#.8x, %s\n", e, msg);
-	exit(e);
+	fprintf(v->err, "[idle_err] %#.8x, %s\n", e, msg);
+	idlevm_stop(v, e);
 }
 
 void idlevm_help() {
@@ -174,13 +309,126 @@ void idlevm_logregs(idle_vm *v) {
 }
 
 void idlevm_init(idle_vm *v) {
+	v->in = stdin;
+	v->out = stdout;
+	v->err = stderr;
+	v->jmp = NULL;
+	v->status = 0;
 	memset(v->regs, 0, sizeof(uint64_t) * IDLE_REGS_COUNT);
-	memset(v->radress, 0, sizeof(uint64_t) * IDLE_RADRESS_COUNT);
+	v->radress = (uint64_t *) calloc(IDLE_RADRESS_COUNT, sizeof(uint64_t));
+	v->radcap = IDLE_RADRESS_COUNT;
 	v->stack = (uint64_t *) calloc(IDLE_DEFAULTSTACK, sizeof(uint64_t));
+#if !defined(_WIN32)
+	/* the whole guest range is reserved up front, only raw data and mapped regions are accessible */
+	void *p = mmap(NULL, IDLE_GUESTSPACE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if(p == MAP_FAILED || mprotect(p, IDLE_RAWDATASIZE, PROT_READ | PROT_WRITE)) {idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);}
+	v->raw_data = (uint8_t *) p;
+#else
 	v->raw_data = (uint8_t *) calloc(IDLE_RAWDATASIZE, sizeof(uint8_t));
+#endif
 	if(v->stack == NULL) {idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);}
+	if(v->radress == NULL) {idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);}
 	if(v->raw_data == NULL) {idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);}
 	v->mp = 2;
+	v->reg = NULL;
+	v->nreg = 0;
+	v->mnext = IDLEVM_MAPBASE;
+	v->icount = 0;
+	v->count = 0;
+	v->trace = NULL;
+	v->prof = NULL;
+	v->compact = 0;
+	v->ncode = 0;
+	v->inint = 0;
+	v->ints = (idlevm_func *) malloc(IDLEBIN_INTCOUNT * sizeof(idlevm_func));
+	if(v->ints == NULL) {idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);}
+	for(uint32_t i = 0; i < IDLEBIN_INTCOUNT; i++) {v->ints[i] = idle_vmint[i].fn;}
+	v->nint = IDLEBIN_INTCOUNT;
+	v->host = NULL;
+	v->nhost = 0;
+	idlevm_bitops_init();
+}
+
+int idlevm_bind(idle_vm *v, const char *name, idlevm_func fn) {
+	/* binding a name again replaces its function, takes effect at the next idlevm_link */
+	if(name == NULL || fn == NULL) {return IDLEVM_ERR_INCORRECT_ARGUMENT;}
+	for(uint32_t i = 0; i < v->nhost; i++) {
+		if(!strcmp(v->host[i].name, name)) {v->host[i].fn = fn; return 0;}
+	}
+	idlevm_native *h = realloc(v->host, (v->nhost + 1) * sizeof(idlevm_native));
+	if(h == NULL) {return IDLEVM_ERR_ALLOCATION_FAILED;}
+	v->host = h;
+	v->host[v->nhost].name = name;
+	v->host[v->nhost++].fn = fn;
+	return 0;
+}
+
+size_t idlevm_link(idle_vm *v, idlevm_command *cm, size_t n) {
+	/*
+		* resolves the imports of the N slots at CM against the bound host
+		* functions into V->INTS, returns the slot count without the import
+		* table, an import nobody bound stops here and not at its first call
+		* for a compact binary it sets V->COMPACT and returns the word count
+	*/
+	idlebin_ftr f; int z; uint64_t ns, np = 0;
+	v->compact = 0;
+	v->ncode = n;
+	if(n < 2) {return n;}
+	memcpy(&f, &cm[n - 2], sizeof(f));
+	/* compact code is NSLOT words padded to a whole slot, the pool fills the gap up to the names */
+	z = !memcmp(f.magic, IDLEBIN_ZMAGIC, 4);
+	ns = z ? ((uint64_t)f.nslot + 1) / 2 : f.nslot;
+	if((!z && memcmp(f.magic, IDLEBIN_MAGIC, 4)) || f.strsz % sizeof(idlevm_command) || ns + f.strsz / sizeof(idlevm_command) + 2 > n) {return n;}
+	np = n - 2 - ns - f.strsz / sizeof(idlevm_command);
+	if(z ? !np : np) {return n;}
+	for(uint64_t i = 0; i < (z ? f.nslot : 0); i++) {
+		uint32_t w = ((const uint32_t *)cm)[i];
+		if((w & IDLEBIN_ZLONG) && (w >> 15) >= np) {idle_error(v, IDLEVM_ERR_INCORRECT_ARGUMENT);}
+	}
+	v->compact = z;
+	ns += np;
+	const char *s = (const char *)&cm[ns], *e = s + f.strsz;
+	idlevm_func *t = (idlevm_func *) realloc(v->ints, ((size_t)IDLEBIN_INTCOUNT + f.nimp) * sizeof(idlevm_func));
+	if(t == NULL) {idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);}
+	v->ints = t;
+	for(uint32_t k = 0; k < f.nimp; k++) {
+		const char *z = memchr(s, 0, (size_t)(e - s));
+		idlevm_func fn = NULL;
+		if(z == NULL || z == s) {idle_error(v, IDLEVM_ERR_INCORRECT_ARGUMENT);}
+		for(uint32_t i = 0; i < v->nhost && !fn; i++) {
+			if(!strcmp(v->host[i].name, s)) {fn = v->host[i].fn;}
+		}
+		if(fn == NULL) {fprintf(v->err, "[idle_err] unresolved import %s\n", s); idle_error(v, IDLEVM_ERR_UNRESOLVED_IMPORT);}
+		t[IDLEBIN_INTCOUNT + k] = fn;
+		s = z + 1;
+	}
+	v->nint = IDLEBIN_INTCOUNT + f.nimp;
+	return f.nslot;
+}
+
+idlevm_command *idlevm_load(idle_vm *v, const char *path, size_t *n) {
+	FILE *ff = fopen(path, "rb");
+	if(ff == NULL) {idle_error(v, IDLEVM_ERR_FILE_NOT_READ);}
+	idlevm_command *cm = calloc(IDLE_FILESIZE, sizeof(idlevm_command));
+	if(!cm) {idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);}
+	*n = fread(cm, sizeof(idlevm_command), IDLE_FILESIZE, ff);
+	fclose(ff);
+	if(!*n) {idle_error(v, IDLEVM_ERR_FILE_NOT_READ);}
+	*n = idlevm_link(v, cm, *n);
+	return cm;
+}
+
+uint64_t *idlevm_growrad(idle_vm *v, uint64_t need) {
+	/* return stack large enough for entry NEED, called by CALL when rta reaches radcap */
+	uint64_t c = v->radcap;
+	while(c <= need && c < IDLE_RADRESS_MAX) {c *= 2;}
+	if(c <= need) {idle_error(v, IDLEVM_ERR_ADRESS_STACK_OVERFLOW);}
+	uint64_t *p = (uint64_t *) realloc(v->radress, c * sizeof(uint64_t));
+	if(p == NULL) {idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);}
+	memset(p + v->radcap, 0, (c - v->radcap) * sizeof(uint64_t));
+	v->radress = p;
+	v->radcap = c;
+	return p;
 }
 
 void idlevm_expandst(idle_vm *v) {
@@ -188,26 +436,506 @@ void idlevm_expandst(idle_vm *v) {
 	if(v->stack == NULL) {idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);}
 }
 
+uint64_t idlevm_addregion(idle_vm *v, uint64_t len, int flags) {
+	/* records a region at MNEXT, the next one starts after an inaccessible gap */
+	idlevm_region *r = realloc(v->reg, (v->nreg + 1) * sizeof(idlevm_region));
+	if(r == NULL) {idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);}
+	v->reg = r;
+	r[v->nreg].addr = v->mnext; r[v->nreg].len = len; r[v->nreg++].flags = flags;
+	v->mnext += (len + IDLE_MAPALIGN - 1) / IDLE_MAPALIGN * IDLE_MAPALIGN + IDLE_MAPALIGN;
+	return r[v->nreg - 1].addr;
+}
+
+uint64_t idlevm_mapfd(idle_vm *v, int fd, uint64_t off, uint64_t len, int flags) {
+	/*
+		* LEN bytes of FD from OFF, a multiple of the page size, shared with the
+		* page cache until the guest writes to a copy-on-write page
+	*/
+#if !defined(_WIN32)
+	long pg = sysconf(_SC_PAGESIZE);
+	if(!len || pg <= 0 || off % (uint64_t)pg || len > IDLE_GUESTSPACE - IDLE_MAPALIGN - v->mnext) {return IDLEVM_MAP_FAILED;}
+	int prot = PROT_READ | (flags & IDLEVM_MAP_COW ? PROT_WRITE : 0);
+	if(mmap(v->raw_data + v->mnext, len, prot, MAP_PRIVATE | MAP_FIXED, fd, (off_t)off) == MAP_FAILED) {return IDLEVM_MAP_FAILED;}
+	return idlevm_addregion(v, len, flags & IDLEVM_MAP_COW);
+#else
+	return IDLEVM_MAP_FAILED;
+#endif
+}
+
+uint64_t idlevm_mapfile(idle_vm *v, const char *path, int flags) {
+#if !defined(_WIN32)
+	struct stat sb; uint64_t a = IDLEVM_MAP_FAILED;
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) {return a;}
+	if(!fstat(fd, &sb) && sb.st_size > 0) {a = idlevm_mapfd(v, fd, 0, (uint64_t)sb.st_size, flags);}
+	close(fd);
+	return a;
+#else
+	return IDLEVM_MAP_FAILED;
+#endif
+}
+
+void *idlevm_mapbuf(idle_vm *v, uint64_t len, uint64_t *addr) {
+	/* a zeroed region the host fills through the returned pointer and the guest sees at *ADDR, NULL on failure */
+#if !defined(_WIN32)
+	if(!len || len > IDLE_GUESTSPACE - IDLE_MAPALIGN - v->mnext) {return NULL;}
+	if(mprotect(v->raw_data + v->mnext, len, PROT_READ | PROT_WRITE)) {return NULL;}
+	*addr = idlevm_addregion(v, len, IDLEVM_MAP_COW);
+	return v->raw_data + *addr;
+#else
+	return NULL;
+#endif
+}
+
+/*
+	* trace records are batched in BUF and written CAP at a time, in ring
+	* mode BUF keeps the last CAP records and is written at close
+	* a record is made when the next instruction starts, so it holds the
+	* value its instruction left in REG, CUR is the record still waiting
+*/
+#define IDLE_TRACEBATCH 4096
+
+struct idlevm_tracer {
+	FILE *f;
+	idletrace_rec *buf;
+	uint32_t cap, len;
+	uint32_t ring, wrap;
+	uint32_t every, left;
+	uint64_t total;
+	int pend, err;
+	idletrace_rec cur;
+};
+
+uint8_t idlevm_tracedst(idlevm_command c) {
+	/* the register an instruction writes, arg1 unless listed here */
+	switch(c.op) {
+	case HLT: case NOP: case JMP: case JE: case JL: case JG: case JLE: case JGE: case JNE:
+	case STB_R: case STB_I: case STDB_R: case STDB_I: case STQB_R: case STQB_I:
+		return IDLETRACE_NOREG;
+	case CMP_R: case CMP_I: case JE_R: case JE_I: case JL_R: case JL_I: case JG_R: case JG_I:
+	case JLE_R: case JLE_I: case JGE_R: case JGE_I: case JNE_R: case JNE_I:
+		return 0;
+	case INT:
+		return 2;
+	case CALL: case RET:
+		return 3;
+	case TCALL: case LRET:
+		return IDLETRACE_NOREG;
+	case LCALL:
+		return 9;
+	case PUSH: case PUSHM:
+		return 8;
+	case ENTER: case LEAVE:
+		return 10;
+	case STS:
+		return IDLETRACE_NOREG;
+	default:
+		return c.op > STS || c.arg1 >= IDLE_REGS_COUNT ? IDLETRACE_NOREG : c.arg1;
+	}
+}
+
+void idlevm_tracepush(idle_vm *v, idlevm_tracer *tr) {
+	if(tr->cur.reg != IDLETRACE_NOREG) {tr->cur.val = v->regs[tr->cur.reg];}
+	tr->buf[tr->len++] = tr->cur;
+	tr->total++;
+	tr->pend = 0;
+	if(tr->len < tr->cap) {return;}
+	if(tr->ring) {tr->len = 0; tr->wrap = 1; return;}
+	tr->err |= fwrite(tr->buf, sizeof(idletrace_rec), tr->len, tr->f) != tr->len;
+	tr->len = 0;
+}
+
+void idlevm_tracestep(idle_vm *v, idlevm_command c, uint64_t ip) {
+	/* called before every instruction while a trace is open, C is the decoded instruction at IP */
+	idlevm_tracer *tr = v->trace;
+	if(tr->pend) {idlevm_tracepush(v, tr);}
+	if(--tr->left) {return;}
+	tr->left = tr->every;
+	tr->cur.ip = (uint32_t)ip;
+	tr->cur.op = c.op;
+	tr->cur.reg = idlevm_tracedst(c);
+	tr->cur.val = 0;
+	tr->pend = 1;
+}
+
+int idlevm_traceopen(idle_vm *v, const char *path, uint32_t every, uint32_t ring) {
+	/* traces every EVERY-th instruction to PATH, only the last RING records when RING is not 0 */
+	idletrace_hdr h = {IDLETRACE_MAGIC, IDLETRACE_VERSION, every ? every : 1, ring, 0};
+	idlevm_tracer *tr = (idlevm_tracer *) calloc(1, sizeof(idlevm_tracer));
+	if(!tr) {return -1;}
+	tr->cap = ring ? ring : IDLE_TRACEBATCH;
+	tr->buf = (idletrace_rec *) malloc(tr->cap * sizeof(idletrace_rec));
+	tr->f = tr->buf ? fopen(path, "wb") : NULL;
+	if(!tr->f || fwrite(&h, sizeof(h), 1, tr->f) != 1) {
+		if(tr->f) {fclose(tr->f);}
+		free(tr->buf); free(tr);
+		return -1;
+	}
+	tr->ring = ring;
+	tr->every = tr->left = h.every;
+	v->trace = tr;
+	return 0;
+}
+
+int idlevm_traceclose(idle_vm *v) {
+	/* writes what is still buffered and the header with the final TOTAL */
+	idlevm_tracer *tr = v->trace; int r;
+	if(!tr) {return 0;}
+	if(tr->pend) {idlevm_tracepush(v, tr);}
+	r = tr->err;
+	if(tr->wrap) {r |= fwrite(tr->buf + tr->len, sizeof(idletrace_rec), tr->cap - tr->len, tr->f) != tr->cap - tr->len;}
+	r |= fwrite(tr->buf, sizeof(idletrace_rec), tr->len, tr->f) != tr->len;
+	if(!fseek(tr->f, offsetof(idletrace_hdr, total), SEEK_SET)) {r |= fwrite(&tr->total, sizeof(tr->total), 1, tr->f) != 1;}
+	r |= fclose(tr->f) != 0;
+	free(tr->buf);
+	free(tr);
+	v->trace = NULL;
+	return r ? -1 : 0;
+}
+
+/*
+	* the profiler takes a sample when the instruction count reaches NEXT:
+	* every EVERY instructions, or with HZ set at the first poll, every
+	* IDLE_PROFPOLL instructions, after a SIGPROF tick
+	* a sample is the entry of the program and of every function a call on
+	* the return stack entered, outermost first, then the label ip is in
+	* when it is not the innermost function's; with a map each slot is
+	* first moved back to the start of its label
+	* distinct stacks are counted in the open hash table TAB, their slots
+	* live in SYM, IDLE_PROFCUT stands for frames left out of a deep stack
+*/
+#define IDLE_PROFPOLL 16381
+#define IDLE_PROFDEPTH 512
+#define IDLE_PROFCUT UINT32_MAX
+
+typedef struct idlevm_plabel {
+	char *name;
+	uint32_t slot;
+} idlevm_plabel;
+
+typedef struct idlevm_pstack {
+	uint64_t h, n;
+	uint32_t off, len;
+} idlevm_pstack;
+
+struct idlevm_profiler {
+	FILE *f;
+	idlevm_plabel *lbl;
+	uint32_t nlbl;
+	idlevm_pstack *tab;
+	uint64_t tcap, tlen;
+	uint32_t *sym;
+	uint64_t scap, slen;
+	uint32_t cur[IDLE_PROFDEPTH + 3];
+	uint64_t every, next;
+	uint32_t hz;
+	int err;
+};
+
+volatile sig_atomic_t idlevm_proftick;
+
+void idlevm_profsig(int sig) {
+	(void)sig;
+	idlevm_proftick = 1;
+}
+
+int idlevm_plabelcmp(const void *a, const void *b) {
+	uint32_t x = ((const idlevm_plabel *)a)->slot, y = ((const idlevm_plabel *)b)->slot;
+	return x < y ? -1 : x > y;
+}
+
+int64_t idlevm_proflabel(const idlevm_profiler *p, uint64_t s) {
+	/* last label at or before slot S, -1 before the first one */
+	int64_t lo = 0, hi = (int64_t)p->nlbl - 1, r = -1;
+	while(lo <= hi) {
+		int64_t md = (lo + hi) / 2;
+		if(p->lbl[md].slot <= s) {r = md; lo = md + 1;} else {hi = md - 1;}
+	}
+	return r;
+}
+
+uint32_t idlevm_profsym(const idlevm_profiler *p, uint64_t s) {
+	int64_t l = idlevm_proflabel(p, s);
+	return l >= 0 ? p->lbl[l].slot : (uint32_t)s;
+}
+
+uint64_t idlevm_proftarget(const idlevm_command *cm, size_t n, int z, uint64_t s) {
+	/* the slot the call at S enters, S itself when it holds no call */
+	uint16_t op; int32_t imm;
+	if(s >= n) {return s;}
+	if(z) {
+		const uint32_t *cz = (const uint32_t *)cm; const uint64_t *zp = (const uint64_t *)cm + (n + 1) / 2;
+		uint32_t w = cz[s];
+		op = (uint16_t)(w & 0xff);
+		imm = w & IDLEBIN_ZLONG ? (int32_t)(uint32_t)zp[w >> 15] : (int32_t)w >> 21;
+	} else {
+		op = cm[s].op;
+		imm = (int32_t)cm[s].imm;
+	}
+	return op == CALL ? s + (int64_t)imm + 1 : s;
+}
+
+void idlevm_profadd(idlevm_profiler *p, uint32_t len) {
+	uint64_t h = UINT64_C(14695981039346656037), i;
+	for(uint32_t j = 0; j < len; j++) {h = (h ^ p->cur[j]) * UINT64_C(1099511628211);}
+	if(p->tlen * 2 >= p->tcap) {
+		/* rehash into twice the slots */
+		uint64_t c = p->tcap ? p->tcap * 2 : 1024;
+		idlevm_pstack *t = (idlevm_pstack *) calloc(c, sizeof(idlevm_pstack));
+		if(!t) {p->err = 1; return;}
+		for(uint64_t k = 0; k < p->tcap; k++) {
+			if(!p->tab[k].n) {continue;}
+			for(i = p->tab[k].h & (c - 1); t[i].n; i = (i + 1) & (c - 1)) {;}
+			t[i] = p->tab[k];
+		}
+		free(p->tab);
+		p->tab = t;
+		p->tcap = c;
+	}
+	for(i = h & (p->tcap - 1); p->tab[i].n; i = (i + 1) & (p->tcap - 1)) {
+		idlevm_pstack *e = &p->tab[i];
+		if(e->h == h && e->len == len && !memcmp(p->sym + e->off, p->cur, len * sizeof(uint32_t))) {e->n++; return;}
+	}
+	if(p->slen + len > p->scap) {
+		uint64_t c = p->scap ? p->scap * 2 : 4096;
+		while(c < p->slen + len) {c *= 2;}
+		uint32_t *s = (uint32_t *) realloc(p->sym, c * sizeof(uint32_t));
+		if(!s) {p->err = 1; return;}
+		p->sym = s;
+		p->scap = c;
+	}
+	memcpy(p->sym + p->slen, p->cur, len * sizeof(uint32_t));
+	p->tab[i].h = h;
+	p->tab[i].n = 1;
+	p->tab[i].off = (uint32_t)p->slen;
+	p->tab[i].len = len;
+	p->slen += len;
+	p->tlen++;
+}
+
+void idlevm_profstep(idle_vm *v, const idlevm_command *cm, size_t n, int z, uint64_t ip) {
+	/* takes a sample before the instruction at IP */
+	idlevm_profiler *p = v->prof;
+	uint64_t rta = v->regs[3] < v->radcap ? v->regs[3] : v->radcap, j = 0; uint32_t len = 0;
+	p->cur[len++] = idlevm_profsym(p, 0);
+	if(rta > IDLE_PROFDEPTH) {p->cur[len++] = IDLE_PROFCUT; j = rta - IDLE_PROFDEPTH;}
+	for(; j < rta; j++) {p->cur[len++] = idlevm_profsym(p, idlevm_proftarget(cm, n, z, v->radress[j]));}
+	uint32_t s = idlevm_profsym(p, ip);
+	if(!p->nlbl || s != p->cur[len - 1]) {p->cur[len++] = s;}
+	idlevm_profadd(p, len);
+}
+
+IDLE_INLINE void idlevm_profpoll(idle_vm *v, const idlevm_command *cm, size_t n, int z, uint64_t ip, uint64_t k) {
+	/*
+		* called when the instruction count K reaches NEXT; a poll without a
+		* tick stays inline, a call out of the interpreter costs a hot loop
+		* the branch history it was predicted by
+	*/
+	idlevm_profiler *p = v->prof;
+	if(!p->hz) {p->next = k + p->every; idlevm_profstep(v, cm, n, z, ip); return;}
+	p->next = k + IDLE_PROFPOLL;
+	if(IDLE_UNLIKELY(idlevm_proftick)) {idlevm_proftick = 0; idlevm_profstep(v, cm, n, z, ip);}
+}
+
+int idlevm_profopen(idle_vm *v, const char *path, const char *map, uint32_t hz, uint64_t every) {
+	/*
+		* samples every EVERY-th instruction, or HZ times a second of process
+		* CPU time when EVERY is 0, and writes folded stacks to PATH at close,
+		* named by the labels of the asm -g MAP when it is not NULL
+		* returns 0 or the idlevm_err of what failed, SIGPROF is the process's
+		* so only one VM can sample by time
+	*/
+	char ln[4096], name[4096]; unsigned a; uint32_t cl = 0;
+	idlevm_profiler *p = (idlevm_profiler *) calloc(1, sizeof(idlevm_profiler));
+	if(!p) {return IDLEVM_ERR_ALLOCATION_FAILED;}
+	if(map) {
+		FILE *f = fopen(map, "r");
+		if(!f || !fgets(ln, sizeof(ln), f) || strncmp(ln, "idledbg 1", 9)) {
+			if(f) {fclose(f);}
+			free(p);
+			return IDLEVM_ERR_FILE_NOT_READ;
+		}
+		while(fgets(ln, sizeof(ln), f)) {
+			if(sscanf(ln, "label %4095s %u", name, &a) != 2) {continue;}
+			idlevm_plabel *l = p->lbl;
+			if(p->nlbl == cl && !(l = (idlevm_plabel *) realloc(p->lbl, (cl = cl ? cl * 2 : 64) * sizeof(idlevm_plabel)))) {p->err = 1; break;}
+			p->lbl = l;
+			if(!(l[p->nlbl].name = (char *) malloc(strlen(name) + 1))) {p->err = 1; break;}
+			strcpy(l[p->nlbl].name, name);
+			l[p->nlbl++].slot = a;
+		}
+		fclose(f);
+		/* asm writes labels in slot order, of several at one slot the first names it */
+		uint32_t m = 0;
+		for(uint32_t i = 1; i < p->nlbl; i++) {if(p->lbl[i].slot < p->lbl[i - 1].slot) {qsort(p->lbl, p->nlbl, sizeof(idlevm_plabel), idlevm_plabelcmp); break;}}
+		for(uint32_t i = 0; i < p->nlbl; i++) {
+			if(m && p->lbl[i].slot == p->lbl[m - 1].slot) {free(p->lbl[i].name);} else {p->lbl[m++] = p->lbl[i];}
+		}
+		p->nlbl = m;
+	}
+	p->f = p->err ? NULL : fopen(path, "w");
+	p->every = every;
+	p->hz = every ? 0 : (hz ? hz : 1);
+	p->next = v->icount + (p->hz ? IDLE_PROFPOLL : every);
+	v->prof = p;
+	if(!p->f) {
+		int e = p->err ? IDLEVM_ERR_ALLOCATION_FAILED : IDLEVM_ERR_FILE_NOT_WRITTEN;
+		p->hz = 0;
+		idlevm_profclose(v);
+		return e;
+	}
+	if(p->hz) {
+#if !defined(_WIN32)
+		struct sigaction sa; struct itimerval it;
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = idlevm_profsig;
+		sa.sa_flags = SA_RESTART;
+		memset(&it, 0, sizeof(it));
+		it.it_interval.tv_sec = p->hz == 1 ? 1 : 0;
+		it.it_interval.tv_usec = p->hz == 1 ? 0 : 1000000 / p->hz;
+		it.it_value = it.it_interval;
+		idlevm_proftick = 0;
+		if(!sigaction(SIGPROF, &sa, NULL) && !setitimer(ITIMER_PROF, &it, NULL)) {return 0;}
+#endif
+		p->hz = 0;
+		idlevm_profclose(v);
+		return IDLEVM_ERR_INCORRECT_ARGUMENT;
+	}
+	return 0;
+}
+
+int idlevm_profclose(idle_vm *v) {
+	/* stops the timer and writes one line per distinct stack: frames joined by ';', a space and the count */
+	idlevm_profiler *p = v->prof; int r;
+	if(!p) {return 0;}
+#if !defined(_WIN32)
+	if(p->hz) {
+		struct itimerval it;
+		memset(&it, 0, sizeof(it));
+		setitimer(ITIMER_PROF, &it, NULL);
+	}
+#endif
+	r = p->err;
+	for(uint64_t i = 0; p->f && i < p->tcap; i++) {
+		idlevm_pstack *e = &p->tab[i];
+		if(!e->n) {continue;}
+		for(uint32_t j = 0; j < e->len; j++) {
+			uint32_t s = p->sym[e->off + j]; int64_t l = idlevm_proflabel(p, s);
+			if(j) {fputc(';', p->f);}
+			if(s == IDLE_PROFCUT) {fputs("...", p->f);}
+			else if(l >= 0 && p->lbl[l].slot == s) {fputs(p->lbl[l].name, p->f);}
+			else {fprintf(p->f, "slot_%u", s);}
+		}
+		fprintf(p->f, " %llu\n", (unsigned long long)e->n);
+	}
+	if(p->f) {r |= ferror(p->f) != 0; r |= fclose(p->f) != 0;}
+	for(uint32_t i = 0; i < p->nlbl; i++) {free(p->lbl[i].name);}
+	free(p->lbl);
+	free(p->tab);
+	free(p->sym);
+	free(p);
+	v->prof = NULL;
+	return r ? -1 : 0;
+}
+
+void idlevm_reset(idle_vm *v) {
+	/*
+		* V as idlevm_init left it, for the next program: registers, stacks
+		* and raw data zeroed, mapped regions gone, the bound host functions,
+		* the streams and JMP kept
+	*/
+	idlevm_traceclose(v);
+	idlevm_profclose(v);
+	v->inint = 0;
+	memset(v->regs, 0, sizeof(v->regs));
+	if(v->radcap != IDLE_RADRESS_COUNT) {
+		uint64_t *p = (uint64_t *) realloc(v->radress, IDLE_RADRESS_COUNT * sizeof(uint64_t));
+		if(p == NULL) {idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);}
+		v->radress = p;
+		v->radcap = IDLE_RADRESS_COUNT;
+	}
+	memset(v->radress, 0, v->radcap * sizeof(uint64_t));
+	if(v->mp != 2) {
+		uint64_t *p = (uint64_t *) realloc(v->stack, IDLE_DEFAULTSTACK * sizeof(uint64_t));
+		if(p == NULL) {idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);}
+		v->stack = p;
+		v->mp = 2;
+	}
+	memset(v->stack, 0, IDLE_DEFAULTSTACK * sizeof(uint64_t));
+#if !defined(_WIN32)
+	/* mapped and host buffer regions go back to reserved, inaccessible address space */
+	if(v->mnext > IDLEVM_MAPBASE && mmap(v->raw_data + IDLEVM_MAPBASE, v->mnext - IDLEVM_MAPBASE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED) {
+		idle_error(v, IDLEVM_ERR_ALLOCATION_FAILED);
+	}
+#endif
+	memset(v->raw_data, 0, IDLE_RAWDATASIZE);
+	free(v->reg);
+	v->reg = NULL;
+	v->nreg = 0;
+	v->mnext = IDLEVM_MAPBASE;
+	v->nint = IDLEBIN_INTCOUNT;
+	v->icount = 0;
+	v->compact = 0;
+	v->status = 0;
+}
+
 void idlevm_free(idle_vm *v) {
+	idlevm_traceclose(v);
+	idlevm_profclose(v);
 	free(v->stack);
+	free(v->radress);
+#if !defined(_WIN32)
+	munmap(v->raw_data, IDLE_GUESTSPACE);
+#else
 	free(v->raw_data);
+#endif
+	free(v->reg);
+	free(v->ints);
+	free(v->host);
 }
 
-int idlevm_run(idle_vm *v, idlevm_command *cm, size_t n) {
+IDLE_INLINE int idlevm_exec(idle_vm *v, idlevm_command *cm, size_t n, const int z, const int ins) {
+	/*
+		* the interpreter, inlined once per encoding and once more instrumented
+		* when INS, so Z and INS are constants; only the instrumented one counts
+		* instructions into ICOUNT and calls the trace and the profiler
+		* IP and N count slots, or words when Z, ZP is the pool after the
+		* words and E the pool entry of the current word
+	*/
 	uint64_t t, t1; int32_t tj;
 	uint64_t *areg = v->regs; uint64_t *astack = v->stack; idlevm_command acm;
-	uint64_t *arad = v->radress;
+	uint64_t *arad = v->radress; uint64_t rcap = v->radcap;
+	uint64_t scap = (v->mp - 1) * IDLE_DEFAULTSTACK;
 	uint8_t *araw = v->raw_data;
+	idlevm_func *aint = v->ints; uint64_t nint = v->nint;
 	uint64_t arg1r, arg2r;
-	uint64_t ip; //uint64_t k=0;
-	for(ip = 0; ip < n; ip++) {
-		acm = cm[ip];
+	uint64_t ip, k = v->icount;
+	const uint32_t *cz = (const uint32_t *)cm; const uint64_t *zp = (const uint64_t *)cm + (n + 1) / 2;
+	uint64_t e = 0; uint32_t w;
+	uint64_t ks = !ins ? UINT64_MAX : v->trace ? k : v->prof ? v->prof->next : UINT64_MAX;
+	for(ip = 0; ip < n; ip++, k++) {
+		if(z) {
+			/* a long word reads its pool entry, idlevm_link checked every index */
+			w = cz[ip];
+			acm.op = (uint16_t)(w & 0xff);
+			acm.arg1 = (uint8_t)(w >> 9 & 0x3f);
+			if(IDLE_UNLIKELY(w & IDLEBIN_ZLONG)) {e = zp[w >> 15]; acm.arg2 = (uint8_t)(e >> 32); acm.imm = (uint32_t)e;}
+			else {acm.arg2 = (uint8_t)(w >> 15 & 0x3f); acm.imm = (uint32_t)((int32_t)w >> 21);}
+		} else {
+			acm = cm[ip];
+		}
+		if(ins && IDLE_UNLIKELY(k >= ks)) {
+			/* one check covers the trace and the profiler, KS is the next instruction that needs either */
+			if(v->trace) {idlevm_tracestep(v, acm, ip);}
+			if(v->prof && k >= v->prof->next) {idlevm_profpoll(v, cm, n, z, ip, k);}
+			ks = v->trace ? k + 1 : v->prof ? v->prof->next : UINT64_MAX;
+		}
 		arg1r = acm.arg1;
 		arg2r = acm.arg2;
 		//uint64_t s = clockCycleCount();
 		switch(acm.op) {
 		case HLT:
-			//printf("%llu\n", k);
+			if(ins) {v->icount = k + 1;}
 			return 0;
 		case NOP:
 			break;
@@ -233,6 +961,61 @@ int idlevm_run(idle_vm *v, idlevm_command *cm, size_t n) {
 		case JNE:
 			ip += (int64_t)((int32_t)acm.imm) & (!!(areg[0] & 0x06) - 1);
 			break;
+		/*
+			* fused compare-and-branch: same flags as CMP, same branch rule as J*,
+			* the _I forms compare against the 8-bit immediate in arg2
+		*/
+		case JE_R:
+			areg[0] = CMPFLAGS(areg[arg1r], areg[arg2r]);
+			ip += (int64_t)((int32_t)acm.imm) & JMPMASK(areg[0], 0x01);
+			break;
+		case JE_I:
+			areg[0] = CMPFLAGS(areg[arg1r], arg2r);
+			ip += (int64_t)((int32_t)acm.imm) & JMPMASK(areg[0], 0x01);
+			break;
+		case JL_R:
+			areg[0] = CMPFLAGS(areg[arg1r], areg[arg2r]);
+			ip += (int64_t)((int32_t)acm.imm) & JMPMASK(areg[0], 0x04);
+			break;
+		case JL_I:
+			areg[0] = CMPFLAGS(areg[arg1r], arg2r);
+			ip += (int64_t)((int32_t)acm.imm) & JMPMASK(areg[0], 0x04);
+			break;
+		case JG_R:
+			areg[0] = CMPFLAGS(areg[arg1r], areg[arg2r]);
+			ip += (int64_t)((int32_t)acm.imm) & JMPMASK(areg[0], 0x02);
+			break;
+		case JG_I:
+			areg[0] = CMPFLAGS(areg[arg1r], arg2r);
+			ip += (int64_t)((int32_t)acm.imm) & JMPMASK(areg[0], 0x02);
+			break;
+		case JLE_R:
+			areg[0] = CMPFLAGS(areg[arg1r], areg[arg2r]);
+			ip += (int64_t)((int32_t)acm.imm) & JMPMASK(areg[0], 0x05);
+			break;
+		case JLE_I:
+			areg[0] = CMPFLAGS(areg[arg1r], arg2r);
+			ip += (int64_t)((int32_t)acm.imm) & JMPMASK(areg[0], 0x05);
+			break;
+		case JGE_R:
+			areg[0] = CMPFLAGS(areg[arg1r], areg[arg2r]);
+			ip += (int64_t)((int32_t)acm.imm) & JMPMASK(areg[0], 0x03);
+			break;
+		case JGE_I:
+			areg[0] = CMPFLAGS(areg[arg1r], arg2r);
+			ip += (int64_t)((int32_t)acm.imm) & JMPMASK(areg[0], 0x03);
+			break;
+		case JNE_R:
+			areg[0] = CMPFLAGS(areg[arg1r], areg[arg2r]);
+			ip += (int64_t)((int32_t)acm.imm) & JMPMASK(areg[0], 0x06);
+			break;
+		case JNE_I:
+			areg[0] = CMPFLAGS(areg[arg1r], arg2r);
+			ip += (int64_t)((int32_t)acm.imm) & JMPMASK(areg[0], 0x06);
+			break;
+		case LOOP:
+			ip += (int64_t)((int32_t)acm.imm) & -(int64_t)(--areg[arg1r] != 0);
+			break;
 		case ADD_R:
 			areg[arg1r] = areg[arg1r] + areg[arg2r];
 			break;
@@ -354,6 +1137,104 @@ int idlevm_run(idle_vm *v, idlevm_command *cm, size_t n) {
 			areg[arg1r] = areg[arg2r]; break;
 		case MOV_I:
 			areg[arg1r] = acm.imm; break;
+		case MOV_W:
+			/* two-slot form: the 64-bit literal is stored in the next slot, compact code keeps it in the pool */
+			if(!z && ip + 1 >= n) {idle_error(v, IDLEVM_ERR_INCORRECT_ARGUMENT);}
+			areg[arg1r] = z ? e : ((uint64_t *)cm)[++ip]; break;
+		/*
+			* cmov<cc>/set<cc> test the atr0 bits written by CMP, a condition holds
+			* when J<cc> falls through; all of these are evaluated without branches
+		*/
+		case CMOVE_R:
+			areg[arg1r] = SELECT(CCMASK(areg[0], 0x01), areg[arg1r], areg[arg2r]); break;
+		case CMOVE_I:
+			areg[arg1r] = SELECT(CCMASK(areg[0], 0x01), areg[arg1r], (uint64_t)acm.imm); break;
+		case CMOVL_R:
+			areg[arg1r] = SELECT(CCMASK(areg[0], 0x04), areg[arg1r], areg[arg2r]); break;
+		case CMOVL_I:
+			areg[arg1r] = SELECT(CCMASK(areg[0], 0x04), areg[arg1r], (uint64_t)acm.imm); break;
+		case CMOVG_R:
+			areg[arg1r] = SELECT(CCMASK(areg[0], 0x02), areg[arg1r], areg[arg2r]); break;
+		case CMOVG_I:
+			areg[arg1r] = SELECT(CCMASK(areg[0], 0x02), areg[arg1r], (uint64_t)acm.imm); break;
+		case CMOVLE_R:
+			areg[arg1r] = SELECT(CCMASK(areg[0], 0x05), areg[arg1r], areg[arg2r]); break;
+		case CMOVLE_I:
+			areg[arg1r] = SELECT(CCMASK(areg[0], 0x05), areg[arg1r], (uint64_t)acm.imm); break;
+		case CMOVGE_R:
+			areg[arg1r] = SELECT(CCMASK(areg[0], 0x03), areg[arg1r], areg[arg2r]); break;
+		case CMOVGE_I:
+			areg[arg1r] = SELECT(CCMASK(areg[0], 0x03), areg[arg1r], (uint64_t)acm.imm); break;
+		case CMOVNE_R:
+			areg[arg1r] = SELECT(CCMASK(areg[0], 0x06), areg[arg1r], areg[arg2r]); break;
+		case CMOVNE_I:
+			areg[arg1r] = SELECT(CCMASK(areg[0], 0x06), areg[arg1r], (uint64_t)acm.imm); break;
+		case SETE:
+			areg[arg1r] = !!(areg[0] & 0x01); break;
+		case SETL:
+			areg[arg1r] = !!(areg[0] & 0x04); break;
+		case SETG:
+			areg[arg1r] = !!(areg[0] & 0x02); break;
+		case SETLE:
+			areg[arg1r] = !!(areg[0] & 0x05); break;
+		case SETGE:
+			areg[arg1r] = !!(areg[0] & 0x03); break;
+		case SETNE:
+			areg[arg1r] = !!(areg[0] & 0x06); break;
+		case MIN_R:
+			t = areg[arg1r]; t1 = areg[arg2r];
+			areg[arg1r] = SELECT(-(uint64_t)(t1 < t), t, t1); break;
+		case MIN_I:
+			t = areg[arg1r]; t1 = acm.imm;
+			areg[arg1r] = SELECT(-(uint64_t)(t1 < t), t, t1); break;
+		case MAX_R:
+			t = areg[arg1r]; t1 = areg[arg2r];
+			areg[arg1r] = SELECT(-(uint64_t)(t1 > t), t, t1); break;
+		case MAX_I:
+			t = areg[arg1r]; t1 = acm.imm;
+			areg[arg1r] = SELECT(-(uint64_t)(t1 > t), t, t1); break;
+		case IMIN_R:
+			t = areg[arg1r]; t1 = areg[arg2r];
+			areg[arg1r] = SELECT(-(uint64_t)((int64_t)t1 < (int64_t)t), t, t1); break;
+		case IMIN_I:
+			t = areg[arg1r]; t1 = acm.imm;
+			areg[arg1r] = SELECT(-(uint64_t)((int64_t)t1 < (int64_t)t), t, t1); break;
+		case IMAX_R:
+			t = areg[arg1r]; t1 = areg[arg2r];
+			areg[arg1r] = SELECT(-(uint64_t)((int64_t)t1 > (int64_t)t), t, t1); break;
+		case IMAX_I:
+			t = areg[arg1r]; t1 = acm.imm;
+			areg[arg1r] = SELECT(-(uint64_t)((int64_t)t1 > (int64_t)t), t, t1); break;
+		case POPCNT:
+			areg[arg1r] = idle_popcnt(areg[arg2r]); break;
+		case LZCNT:
+			areg[arg1r] = idle_lzcnt(areg[arg2r]); break;
+		case TZCNT:
+			areg[arg1r] = idle_tzcnt(areg[arg2r]); break;
+		case BSWAP:
+#ifdef __GNUC__
+			areg[arg1r] = __builtin_bswap64(areg[arg1r]); break;
+#else
+			t = areg[arg1r];
+			t = ((t & UINT64_C(0x00ff00ff00ff00ff)) << 8) | ((t >> 8) & UINT64_C(0x00ff00ff00ff00ff));
+			t = ((t & UINT64_C(0x0000ffff0000ffff)) << 16) | ((t >> 16) & UINT64_C(0x0000ffff0000ffff));
+			areg[arg1r] = (t << 32) | (t >> 32); break;
+#endif
+		case ROL_R:
+			areg[arg1r] = ROL(areg[arg1r], areg[arg2r]); break;
+		case ROL_I:
+			areg[arg1r] = ROL(areg[arg1r], (uint64_t)acm.imm); break;
+		case ROR_R:
+			areg[arg1r] = ROR(areg[arg1r], areg[arg2r]); break;
+		case ROR_I:
+			areg[arg1r] = ROR(areg[arg1r], (uint64_t)acm.imm); break;
+		case CRC32:
+			areg[arg1r] = idle_crc32(areg[arg1r], areg[arg2r]); break;
+		case UMULH_R:
+			areg[arg1r] = (uint64_t)(((idle_u128)areg[arg1r] * areg[arg2r]) >> 64); break;
+		case UMULH_W:
+			if(!z && ip + 1 >= n) {idle_error(v, IDLEVM_ERR_INCORRECT_ARGUMENT);}
+			areg[arg1r] = (uint64_t)(((idle_u128)areg[arg1r] * (z ? e : ((uint64_t *)cm)[++ip])) >> 64); break;
 		case CMP_R:
 			t = areg[arg1r];
 			t1 = areg[arg2r];
@@ -370,12 +1251,60 @@ int idlevm_run(idle_vm *v, idlevm_command *cm, size_t n) {
 			areg[arg2r] = t;
 			break;
 		case PUSH:
+			if(areg[8] >= scap) {idle_error(v, IDLEVM_ERR_STACK_OVERFLOW);}
 			astack[areg[8]++] = areg[arg1r]; break;
 		case POP:
+			if(!areg[8] || areg[8] > scap) {idle_error(v, IDLEVM_ERR_STACK_UNDERFLOW);}
 			areg[arg1r] = astack[--areg[8]]; break;
+		/*
+			* frames: enter N saves fp, points fp at the first of N locals above
+			* it and moves sp past them, leave undoes that; pushm/popm move the
+			* register range arg1..arg2 in one block, lds/sts address the stack
+			* at a register plus the signed imm
+		*/
+		case ENTER:
+			t = areg[8] + 1 + acm.imm;
+			if(t > scap || t <= areg[8]) {idle_error(v, IDLEVM_ERR_STACK_OVERFLOW);}
+			astack[areg[8]] = areg[10];
+			areg[10] = areg[8] + 1;
+			areg[8] = t;
+			break;
+		case LEAVE:
+			if(!areg[10] || areg[10] > scap) {idle_error(v, IDLEVM_ERR_STACK_UNDERFLOW);}
+			areg[8] = areg[10] - 1;
+			areg[10] = astack[areg[8]];
+			break;
+		case PUSHM:
+			t = arg2r - arg1r + 1;
+			if(arg2r < arg1r || arg2r >= IDLE_REGS_COUNT) {idle_error(v, IDLEVM_ERR_INCORRECT_ARGUMENT);}
+			if(areg[8] > scap - t) {idle_error(v, IDLEVM_ERR_STACK_OVERFLOW);}
+			memcpy(&astack[areg[8]], &areg[arg1r], t * sizeof(uint64_t));
+			areg[8] += t;
+			break;
+		case POPM:
+			t = arg2r - arg1r + 1;
+			if(arg2r < arg1r || arg2r >= IDLE_REGS_COUNT) {idle_error(v, IDLEVM_ERR_INCORRECT_ARGUMENT);}
+			if(areg[8] < t || areg[8] > scap) {idle_error(v, IDLEVM_ERR_STACK_UNDERFLOW);}
+			areg[8] -= t;
+			memcpy(&areg[arg1r], &astack[areg[8]], t * sizeof(uint64_t));
+			break;
+		case LDS:
+			t = areg[arg2r] + (int64_t)((int32_t)acm.imm);
+			if(t >= scap) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			areg[arg1r] = astack[t];
+			break;
+		case STS:
+			t = areg[arg2r] + (int64_t)((int32_t)acm.imm);
+			if(t >= scap) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			astack[t] = areg[arg1r];
+			break;
 		case INT:
-			if(acm.imm > arraysize(idle_vmint)) {idle_error(v, IDLEVM_ERR_INCORRECT_INT_NUMBER);}
-			idle_vmint[acm.imm](v, cm); break;
+			if(acm.imm >= nint) {idle_error(v, IDLEVM_ERR_INCORRECT_INT_NUMBER);}
+			if(ins) {v->icount = k + 1;}
+			v->inint = 1;
+			aint[acm.imm](v, cm);
+			v->inint = 0;
+			break;
 		case BT_R:
 			areg[arg1r] = BIT(areg[arg1r], areg[arg2r]); break;
 		case BT_I:
@@ -393,50 +1322,96 @@ int idlevm_run(idle_vm *v, idlevm_command *cm, size_t n) {
 		case BTI_I:
 			areg[arg1r] = BITINVERT(areg[arg1r], acm.imm); break;
 		case CALL:
-			if(areg[3] >= IDLE_RADRESS_COUNT) {idle_error(v, IDLEVM_ERR_ADRESS_STACK_OVERFLOW);}
+			if(areg[3] >= rcap) {arad = idlevm_growrad(v, areg[3]); rcap = v->radcap;}
 			arad[areg[3]++] = ip;
 			tj = (int32_t)acm.imm;
-			ip = (int64_t)tj;
+			ip += (int64_t)tj;
 			break;
 		case RET:
 			if(!areg[3]) {idle_error(v, IDLEVM_ERR_ADRESS_STACK_UNDERFLOW);}
+			if(areg[3] > rcap) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
 			ip = arad[--areg[3]];
 			break;
+		/*
+			* tcall = call + ret, the callee returns to our caller, so it is a jump
+			* kept apart for tools; lcall/lret keep the return slot in rtaa and
+			* never touch the return stack, for leaf functions
+		*/
+		case TCALL:
+			ip += (int64_t)((int32_t)acm.imm);
+			break;
+		case LCALL:
+			areg[9] = ip;
+			ip += (int64_t)((int32_t)acm.imm);
+			break;
+		case LRET:
+			if(areg[9] >= n) {idle_error(v, IDLEVM_ERR_INCORRECT_ARGUMENT);}
+			ip = areg[9];
+			break;
+		/*
+			* loads and stores index raw data in elements of their width, an
+			* element past IDLEVM_GUESTLIMIT stops here, one in a hole of the
+			* reserved range faults into idlevm_fault
+		*/
 		case LDB_R:
-			areg[arg1r] = (uint64_t)araw[areg[arg2r]];
+			t = areg[arg2r];
+			if(IDLE_UNLIKELY(t >= IDLEVM_GUESTLIMIT)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			areg[arg1r] = (uint64_t)araw[t];
 			break;
 		case LDB_I:
-			areg[arg1r] = (uint64_t)araw[acm.imm];
+			t = acm.imm;
+			if(IDLE_UNLIKELY(t >= IDLEVM_GUESTLIMIT)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			areg[arg1r] = (uint64_t)araw[t];
 			break;
 		case LDDB_R:
-			areg[arg1r] = (uint64_t)((uint16_t *)araw)[areg[arg2r]];
+			t = areg[arg2r];
+			if(IDLE_UNLIKELY(t >= IDLEVM_GUESTLIMIT / 2)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			areg[arg1r] = (uint64_t)((uint16_t *)araw)[t];
 			break;
 		case LDDB_I:
-			areg[arg1r] = (uint64_t)((uint16_t *)araw)[acm.imm];
+			t = acm.imm;
+			if(IDLE_UNLIKELY(t >= IDLEVM_GUESTLIMIT / 2)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			areg[arg1r] = (uint64_t)((uint16_t *)araw)[t];
 			break;
 		case LDQB_R:
-			areg[arg1r] = (uint64_t)((uint32_t *)araw)[areg[arg2r]];
+			t = areg[arg2r];
+			if(IDLE_UNLIKELY(t >= IDLEVM_GUESTLIMIT / 4)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			areg[arg1r] = (uint64_t)((uint32_t *)araw)[t];
 			break;
 		case LDQB_I:
-			areg[arg1r] = (uint64_t)((uint32_t *)araw)[acm.imm];
+			t = acm.imm;
+			if(IDLE_UNLIKELY(t >= IDLEVM_GUESTLIMIT / 4)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			areg[arg1r] = (uint64_t)((uint32_t *)araw)[t];
 			break;
 		case STB_R:
-			araw[areg[arg2r]] = (uint8_t)areg[arg1r];
+			t = areg[arg2r];
+			if(IDLE_UNLIKELY(t >= IDLEVM_GUESTLIMIT)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			araw[t] = (uint8_t)areg[arg1r];
 			break;
 		case STB_I:
-			araw[acm.imm] = (uint8_t)areg[arg1r];
+			t = acm.imm;
+			if(IDLE_UNLIKELY(t >= IDLEVM_GUESTLIMIT)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			araw[t] = (uint8_t)areg[arg1r];
 			break;
 		case STDB_R:
-			((uint16_t *)araw)[areg[arg2r]] = (uint16_t)areg[arg1r];
+			t = areg[arg2r];
+			if(IDLE_UNLIKELY(t >= IDLEVM_GUESTLIMIT / 2)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			((uint16_t *)araw)[t] = (uint16_t)areg[arg1r];
 			break;
 		case STDB_I:
-			((uint16_t *)araw)[acm.imm] = (uint16_t)areg[arg1r];
+			t = acm.imm;
+			if(IDLE_UNLIKELY(t >= IDLEVM_GUESTLIMIT / 2)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			((uint16_t *)araw)[t] = (uint16_t)areg[arg1r];
 			break;
 		case STQB_R:
-			((uint32_t *)araw)[areg[arg2r]] = (uint32_t)areg[arg1r];
+			t = areg[arg2r];
+			if(IDLE_UNLIKELY(t >= IDLEVM_GUESTLIMIT / 4)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			((uint32_t *)araw)[t] = (uint32_t)areg[arg1r];
 			break;
 		case STQB_I:
-			((uint32_t *)araw)[acm.imm] = (uint32_t)areg[arg1r];
+			t = acm.imm;
+			if(IDLE_UNLIKELY(t >= IDLEVM_GUESTLIMIT / 4)) {idle_error(v, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+			((uint32_t *)araw)[t] = (uint32_t)areg[arg1r];
 			break;
 		default:
 			idle_error(v, IDLEVM_ERR_INCORRECT_OPCODE);
@@ -444,9 +1419,14 @@ int idlevm_run(idle_vm *v, idlevm_command *cm, size_t n) {
 		//uint64_t e = clockCycleCount();
 		//printf("%i: %llu\n", acm.op, (e-s));
 	}
-	//printf("%llu\n", k);
+	if(ins) {v->icount = k;}
 	return 0;
 }
+
+int idlevm_run(idle_vm *v, idlevm_command *cm, size_t n) {
+	if(v->count || v->trace || v->prof) {return v->compact ? idlevm_exec(v, cm, n, 1, 1) : idlevm_exec(v, cm, n, 0, 1);}
+	return v->compact ? idlevm_exec(v, cm, n, 1, 0) : idlevm_exec(v, cm, n, 0, 0);
+}
 /*
 int main() {
 	idle_vm v;
@@ -457,24 +1437,188 @@ int main() {
 }
 */
 
-int main(int argc, char **argv) {
-	if(argc < 2) {return 0;}
+#if !defined(_WIN32)
+void idlevm_fault(int sig) {
+	/* a load or store outside raw data and the mapped regions, or a store to a read-only one */
+	static const char m[] = "[idle_err] 0x00000003, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS\n";
+	if(write(2, m, sizeof(m) - 1) < 0) {_exit(IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);}
+	_exit(IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS);
+}
+#endif
 
-	FILE *ff = fopen(argv[1], "rb");
+#ifndef IDLEVM_EMBED
+/*
+	* --perf-counters: hardware counters around idlevm_run, user mode only,
+	* each one scaled by the share of the run it was scheduled on the PMU;
+	* a counter the kernel refuses is null, with none of them the run is
+	* measured by the software clocks alone
+*/
+#define IDLE_PERFCOUNT 5
 
-	idlevm_command *cm = calloc(IDLE_FILESIZE, sizeof(idlevm_command));
+typedef struct idle_perf {
+	idle_vm *v;
+	const char *out;
+	int fd[IDLE_PERFCOUNT];
+	int on;
+	double wall, cpu;
+} idle_perf;
 
-	size_t n = fread(cm, sizeof(idlevm_command), IDLE_FILESIZE, ff);
+idle_perf idle_pf;
 
-	idle_vm v;
+const char *idle_perfname[IDLE_PERFCOUNT] = {"cycles", "instructions", "branch_misses", "l1i_misses", "l1d_misses"};
+
+double idlevm_clock(int cpu) {
+#if !defined(_WIN32)
+	struct timespec t;
+	clock_gettime(cpu ? CLOCK_PROCESS_CPUTIME_ID : CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+void idlevm_perfstop(void) {
+	/* also runs from atexit, so int exit and runtime errors still report */
+	if(!idle_pf.on) {return;}
+	idle_pf.on = 0;
+	double c[IDLE_PERFCOUNT]; int hw = 0;
+#if defined(__linux__)
+	for(int i = 0; i < IDLE_PERFCOUNT; i++) {
+		if(idle_pf.fd[i] >= 0) {ioctl(idle_pf.fd[i], PERF_EVENT_IOC_DISABLE, 0);}
+	}
+#endif
+	double wall = idlevm_clock(0) - idle_pf.wall, cpu = idlevm_clock(1) - idle_pf.cpu;
+	for(int i = 0; i < IDLE_PERFCOUNT; i++) {
+		c[i] = -1;
+#if defined(__linux__)
+		/* value, time enabled, time running */
+		uint64_t r[3];
+		if(idle_pf.fd[i] < 0) {continue;}
+		if(read(idle_pf.fd[i], r, sizeof(r)) == (ssize_t)sizeof(r) && r[2]) {c[i] = (double)r[0] * ((double)r[1] / (double)r[2]); hw++;}
+		close(idle_pf.fd[i]);
+#endif
+	}
+
+	FILE *f = idle_pf.out ? fopen(idle_pf.out, "w") : NULL;
+	uint64_t g = idle_pf.v->icount;
+	if(!f) {f = stderr;}
+	fprintf(f, "{\"source\":\"%s\",\"guest_instructions\":%llu,\"wall_sec\":%.9f,\"cpu_sec\":%.9f,\"guest_per_sec\":%.0f",
+		hw ? "perf_event" : "software", (unsigned long long)g, wall, cpu, wall > 0 ? (double)g / wall : 0.0);
+	for(int i = 0; i < IDLE_PERFCOUNT; i++) {
+		if(c[i] < 0) {fprintf(f, ",\"%s\":null", idle_perfname[i]);} else {fprintf(f, ",\"%s\":%.0f", idle_perfname[i], c[i]);}
+	}
+	if(c[0] > 0) {fprintf(f, ",\"guest_per_cycle\":%.6f", (double)g / c[0]);} else {fputs(",\"guest_per_cycle\":null", f);}
+	if(c[1] >= 0 && g) {fprintf(f, ",\"host_per_guest\":%.3f", c[1] / (double)g);} else {fputs(",\"host_per_guest\":null", f);}
+	fputs("}\n", f);
+	if(f != stderr) {fclose(f);}
+}
+
+void idlevm_perfstart(idle_vm *v, const char *out) {
+	idle_pf.v = v;
+	idle_pf.out = out;
+	v->count = 1;
+	for(int i = 0; i < IDLE_PERFCOUNT; i++) {idle_pf.fd[i] = -1;}
+#if defined(__linux__)
+	static const uint32_t type[IDLE_PERFCOUNT] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE};
+	static const uint64_t cfg[IDLE_PERFCOUNT] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+		PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+	};
+	struct perf_event_attr a;
+	for(int i = 0; i < IDLE_PERFCOUNT; i++) {
+		memset(&a, 0, sizeof(a));
+		a.size = sizeof(a);
+		a.type = type[i];
+		a.config = cfg[i];
+		a.disabled = 1;
+		a.exclude_kernel = 1;
+		a.exclude_hv = 1;
+		a.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		idle_pf.fd[i] = (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+	}
+#endif
+	idle_pf.on = 1;
+	atexit(idlevm_perfstop);
+	idle_pf.wall = idlevm_clock(0);
+	idle_pf.cpu = idlevm_clock(1);
+#if defined(__linux__)
+	for(int i = 0; i < IDLE_PERFCOUNT; i++) {
+		if(idle_pf.fd[i] >= 0) {ioctl(idle_pf.fd[i], PERF_EVENT_IOC_ENABLE, 0);}
+	}
+#endif
+}
+
+idle_vm *idle_trv;
+
+void idlevm_traceexit(void) {
+	/* int exit and runtime errors leave through exit, the trace and the profile are finished here */
+	if(idle_trv && (idlevm_traceclose(idle_trv) | idlevm_profclose(idle_trv))) {fprintf(stderr, "[idle_err] %#.8x, %s\n", IDLEVM_ERR_FILE_NOT_WRITTEN, "IDLEVM_ERR_FILE_NOT_WRITTEN");}
+}
+
+int main(int argc, char **argv) {
+	if(argc < 2) {return 0;}
+
+	idle_vm v; size_t n; int perf = 0; const char *pout = NULL;
+	const char *tout = NULL; uint32_t tevery = 1, tring = 0;
+	const char *fout = NULL, *fmap = NULL; uint32_t fhz = 997; uint64_t fevery = 0;
 
 	idlevm_init(&v);
 
-	if(!cm) {idle_error(&v, IDLEVM_ERR_ALLOCATION_FAILED);}
-	if(!n) {idle_error(&v, IDLEVM_ERR_FILE_NOT_READ);}
+	/*
+		* -m FILE maps a file read-only, -M FILE copy-on-write, regions are numbered in order
+		* --perf-counters[=FILE] writes one JSON object to FILE or stderr after the run
+		* --trace=FILE records the run, --trace-every=N every N-th instruction only,
+		* --trace-ring=N only the last N records
+		* --profile=FILE writes sampled call stacks folded, --profile-hz=N samples
+		* N times a second of CPU time, --profile-every=N every N-th instruction
+		* instead, --profile-map=FILE names them from the asm -g map
+	*/
+	for(int a = 2; a < argc; a++) {
+		if(!strncmp(argv[a], "--trace=", 8)) {tout = argv[a] + 8; continue;}
+		if(!strncmp(argv[a], "--trace-every=", 14)) {tevery = (uint32_t)strtoul(argv[a] + 14, NULL, 10); continue;}
+		if(!strncmp(argv[a], "--trace-ring=", 13)) {tring = (uint32_t)strtoul(argv[a] + 13, NULL, 10); continue;}
+		if(!strncmp(argv[a], "--profile=", 10)) {fout = argv[a] + 10; continue;}
+		if(!strncmp(argv[a], "--profile-hz=", 13)) {fhz = (uint32_t)strtoul(argv[a] + 13, NULL, 10); continue;}
+		if(!strncmp(argv[a], "--profile-every=", 16)) {fevery = strtoull(argv[a] + 16, NULL, 10); continue;}
+		if(!strncmp(argv[a], "--profile-map=", 14)) {fmap = argv[a] + 14; continue;}
+		if(!strncmp(argv[a], "--perf-counters", 15) && (!argv[a][15] || argv[a][15] == '=')) {
+			perf = 1;
+			pout = argv[a][15] ? argv[a] + 16 : NULL;
+			continue;
+		}
+		int fl = !strcmp(argv[a], "-M") ? IDLEVM_MAP_COW : IDLEVM_MAP_RDONLY;
+		if(a + 1 >= argc || (strcmp(argv[a], "-m") && strcmp(argv[a], "-M"))) {idle_error(&v, IDLEVM_ERR_INCORRECT_ARGUMENT);}
+		if(idlevm_mapfile(&v, argv[++a], fl) == IDLEVM_MAP_FAILED) {idle_error(&v, IDLEVM_ERR_FILE_NOT_READ);}
+	}
+
+#if !defined(_WIN32)
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = idlevm_fault;
+	sigaction(SIGSEGV, &sa, NULL);
+	sigaction(SIGBUS, &sa, NULL);
+#endif
+
+	idlevm_command *cm = idlevm_load(&v, argv[1], &n);
 
 	//uint64_t s = clockCycleCount();
+	if(tout && idlevm_traceopen(&v, tout, tevery, tring)) {idle_error(&v, IDLEVM_ERR_FILE_NOT_WRITTEN);}
+	if(fout) {
+		int e = idlevm_profopen(&v, fout, fmap, fhz, fevery);
+		if(e == IDLEVM_ERR_FILE_NOT_READ) {idle_error(&v, IDLEVM_ERR_FILE_NOT_READ);}
+		if(e == IDLEVM_ERR_INCORRECT_ARGUMENT) {idle_error(&v, IDLEVM_ERR_INCORRECT_ARGUMENT);}
+		if(e) {idle_error(&v, IDLEVM_ERR_FILE_NOT_WRITTEN);}
+	}
+	if(tout || fout) {
+		idle_trv = &v;
+		atexit(idlevm_traceexit);
+	}
+	if(perf) {idlevm_perfstart(&v, pout);}
 	idlevm_run(&v, cm, n);
+	idlevm_perfstop();
+	idle_trv = NULL;
+	if(idlevm_traceclose(&v) | idlevm_profclose(&v)) {idle_error(&v, IDLEVM_ERR_FILE_NOT_WRITTEN);}
 	//uint64_t e = clockCycleCount();
 
 	//printf("%llu\n", (e-s));
@@ -485,7 +1629,6 @@ int main(int argc, char **argv) {
 
 	free(cm);
 
-	fclose(ff);
-
 	return 0;
 }
+#endif
@@ -0,0 +1,196 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+	* client of vmd.exe
+	*
+	* vmc.exe socket program.bin [-n count]
+	*	runs the binary on the server with this process's stdin, writes its
+	*	stdout and stderr and exits with its status like vm.exe would; the
+	*	binary is sent by hash first and in full only when the server
+	*	does not have it
+	*	-n sends the same request COUNT times on one connection and reports
+	*	the round-trip latencies on stderr, the output is that of the first
+*/
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "idlevmd.h"
+
+#define idlevmc_error(mac, msg) idlevmc_logerr(mac, msg)
+
+typedef enum idlevmc_err {
+	IDLEVMC_ERR_SUCCESSFUL_EXIT = 0,
+	IDLEVMC_ERR_FAILED_EXIT,
+	IDLEVMC_ERR_ALLOCATION_FAILED,
+	IDLEVMC_ERR_FILE_NOT_READ,
+	IDLEVMC_ERR_SOCKET_FAILED,
+	IDLEVMC_ERR_BAD_RESPONSE,
+} idlevmc_err;
+
+void idlevmc_logerr(int e, const char *msg) {
+	fprintf(stderr, "[idlevmc_err] %#.8x, %s\n", e, msg);
+	exit(e);
+}
+
+#if !defined(_WIN32)
+void *idlevmc_slurp(FILE *f, uint64_t *n) {
+	/* the whole stream in one buffer */
+	size_t cap = 65536, k = 0, r; char *p = malloc(cap);
+	if(!p) {idlevmc_error(IDLEVMC_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+	while((r = fread(p + k, 1, cap - k, f)) > 0) {
+		k += r;
+		if(k == cap && !(p = realloc(p, cap *= 2))) {idlevmc_error(IDLEVMC_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+	}
+	*n = k;
+	return p;
+}
+
+void idlevmc_read(int fd, void *p, uint64_t n) {
+	for(uint64_t k = 0; k < n;) {
+		ssize_t r = read(fd, (char *)p + k, n - k);
+		if(r < 0 && errno == EINTR) {continue;}
+		if(r <= 0) {idlevmc_error(IDLEVMC_ERR_SOCKET_FAILED, "connection closed by the server");}
+		k += (uint64_t)r;
+	}
+}
+
+void idlevmc_write(int fd, const void *p, uint64_t n) {
+	for(uint64_t k = 0; k < n;) {
+		ssize_t r = send(fd, (const char *)p + k, n - k, MSG_NOSIGNAL);
+		if(r < 0 && errno == EINTR) {continue;}
+		if(r <= 0) {idlevmc_error(IDLEVMC_ERR_SOCKET_FAILED, "connection closed by the server");}
+		k += (uint64_t)r;
+	}
+}
+
+void idlevmc_send(int fd, uint64_t hash, const void *prog, uint64_t nprog, const void *in, uint64_t nin) {
+	idlevmd_req q;
+	memcpy(q.magic, IDLEVMD_MAGIC, 4);
+	q.version = IDLEVMD_VERSION;
+	q.hash = hash;
+	q.nprog = nprog;
+	q.nin = nin;
+	idlevmc_write(fd, &q, sizeof(q));
+	idlevmc_write(fd, prog, nprog);
+	idlevmc_write(fd, in, nin);
+}
+
+void idlevmc_recv(int fd, idlevmd_rsp *r) {
+	idlevmc_read(fd, r, sizeof(*r));
+	if(memcmp(r->magic, IDLEVMD_RMAGIC, 4) || (r->flags & IDLEVMD_BAD)) {idlevmc_error(IDLEVMC_ERR_BAD_RESPONSE, "request refused by the server");}
+}
+
+double idlevmc_now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+int idlevmc_cmp(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+int idlevmc_main(int argc, char **argv) {
+	const char *path = NULL, *bin = NULL; long cnt = 1;
+	uint64_t nprog, nin, hash; struct sockaddr_un sa; idlevmd_rsp r; int status = 0;
+	for(int a = 1; a < argc; a++) {
+		if(a + 1 < argc && !strcmp(argv[a], "-n")) {cnt = atol(argv[++a]);}
+		else if(argv[a][0] != '-' && !path) {path = argv[a];}
+		else if(argv[a][0] != '-' && !bin) {bin = argv[a];}
+		else {bin = NULL; break;}
+	}
+	if(!path || !bin || cnt < 1) {
+		fprintf(stderr, "usage: vmc socket program.bin [-n count]\n");
+		return IDLEVMC_ERR_FAILED_EXIT;
+	}
+	FILE *f = fopen(bin, "rb");
+	if(!f) {idlevmc_error(IDLEVMC_ERR_FILE_NOT_READ, "failed to read file");}
+	char *prog = idlevmc_slurp(f, &nprog);
+	fclose(f);
+	if(!nprog || nprog > IDLEVMD_MAXPROG) {idlevmc_error(IDLEVMC_ERR_FILE_NOT_READ, "binary is empty or too large");}
+	char *in = idlevmc_slurp(stdin, &nin);
+	hash = idlevmd_hash(prog, nprog);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	if(strlen(path) >= sizeof(sa.sun_path)) {idlevmc_error(IDLEVMC_ERR_SOCKET_FAILED, "socket path is too long");}
+	strcpy(sa.sun_path, path);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0 || connect(fd, (struct sockaddr *)&sa, sizeof(sa))) {idlevmc_error(IDLEVMC_ERR_SOCKET_FAILED, "cannot connect to the server");}
+
+	double *lat = malloc((size_t)cnt * sizeof(double));
+	if(!lat) {idlevmc_error(IDLEVMC_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+	for(long i = 0; i < cnt; i++) {
+		double t = idlevmc_now();
+		idlevmc_send(fd, hash, NULL, 0, in, nin);
+		idlevmc_recv(fd, &r);
+		if(r.flags & IDLEVMD_MISS) {
+			idlevmc_send(fd, hash, prog, nprog, in, nin);
+			idlevmc_recv(fd, &r);
+			if(r.flags & IDLEVMD_MISS) {idlevmc_error(IDLEVMC_ERR_BAD_RESPONSE, "binary refused by the server");}
+		}
+		char *out = malloc(r.nout + r.nerr + 1);
+		if(!out) {idlevmc_error(IDLEVMC_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+		idlevmc_read(fd, out, r.nout + r.nerr);
+		lat[i] = idlevmc_now() - t;
+		if(!i) {
+			fwrite(out, 1, r.nout, stdout);
+			fflush(stdout);
+			fwrite(out + r.nout, 1, r.nerr, stderr);
+			status = r.status;
+		}
+		free(out);
+	}
+	close(fd);
+	if(cnt > 1) {
+		/* the first request may have sent the binary, it is left out */
+		qsort(lat + 1, (size_t)cnt - 1, sizeof(double), idlevmc_cmp);
+		long m = cnt - 1;
+		fprintf(stderr, "vmc: first %.1f us, then %ld requests: min %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+			lat[0] * 1e6, m, lat[1] * 1e6, lat[1 + m / 2] * 1e6, lat[1 + m * 99 / 100] * 1e6, lat[m] * 1e6);
+	}
+	free(lat); free(prog); free(in);
+	return status;
+}
+#else
+int idlevmc_main(int argc, char **argv) {
+	fprintf(stderr, "vmc: needs Unix domain sockets\n");
+	return IDLEVMC_ERR_FAILED_EXIT;
+}
+#endif
+
+int main(int argc, char **argv) {
+	return idlevmc_main(argc, argv);
+}
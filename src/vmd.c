@@ -0,0 +1,345 @@
+/*
+Copyright 2025 nightmilkyway
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+	* resident VM server, build with src/vm.c -DIDLEVM_EMBED
+	*
+	* vmd.exe socket [-j workers] [-c programs]
+	*	listens on the Unix socket, WORKERS threads (4 by default) each own
+	*	one idle_vm and serve one connection at a time, binaries are cached
+	*	by hash, up to PROGRAMS of them (256 by default), the least recently
+	*	used one not running is dropped first; protocol in idlevmd.h
+*/
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <errno.h>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "idlevm.h"
+#include "idlevmd.h"
+
+#define idlevmd_error(mac, msg) idlevmd_logerr(mac, msg)
+
+typedef enum idlevmd_err {
+	IDLEVMD_ERR_SUCCESSFUL_EXIT = 0,
+	IDLEVMD_ERR_FAILED_EXIT,
+	IDLEVMD_ERR_ALLOCATION_FAILED,
+	IDLEVMD_ERR_SOCKET_FAILED,
+} idlevmd_err;
+
+void idlevmd_logerr(int e, const char *msg) {
+	fprintf(stderr, "[idlevmd_err] %#.8x, %s\n", e, msg);
+	exit(e);
+}
+
+#if !defined(_WIN32)
+typedef struct vmdprog_t {
+	/*
+		* one binary, CODE = its NBYTE bytes padded to a whole slot
+		* REF = requests running it, USED = tick of the last one, LIVE = it
+		* is in the cache, a dropped or uncached one is freed by its last user
+	*/
+	uint64_t hash;
+	uint64_t *code;
+	uint64_t nbyte;
+	uint64_t used;
+	unsigned ref;
+	int live;
+} vmdprog_t;
+
+typedef struct vmdcache_t {
+	pthread_mutex_t mu;
+	vmdprog_t **e;
+	unsigned cap;
+	uint64_t tick;
+} vmdcache_t;
+
+typedef struct vmdworker_t {
+	pthread_t th;
+	int ls;
+	vmdcache_t *c;
+	idle_vm v;
+} vmdworker_t;
+
+/* the fault handler's way back into the request of its thread, NULL outside a run, and the thread's VM */
+static __thread sigjmp_buf *idlevmd_fjb;
+static __thread idle_vm *idlevmd_fvm;
+
+void idlevmd_fault(int sig, siginfo_t *si, void *uc) {
+	/*
+		* only a fault on the guest range of this thread's VM, taken while
+		* guest code and not an interrupt runs, ends the request; any other
+		* is the server's own and kills it with the signal, rather than being
+		* reported as the guest's
+	*/
+	idle_vm *v = idlevmd_fvm;
+	uintptr_t a = (uintptr_t)si->si_addr;
+	if(idlevmd_fjb && v && !v->inint && a - (uintptr_t)v->raw_data < IDLEVM_GUESTLIMIT) {siglongjmp(*idlevmd_fjb, 1);}
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+void *idlevmd_alloc(size_t n) {
+	void *p = calloc(1, n ? n : 1);
+	if(!p) {idlevmd_error(IDLEVMD_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+	return p;
+}
+
+void idlevmd_free(vmdprog_t *p) {
+	free(p->code);
+	free(p);
+}
+
+vmdprog_t *idlevmd_get(vmdcache_t *c, uint64_t hash) {
+	vmdprog_t *p = NULL;
+	pthread_mutex_lock(&c->mu);
+	for(unsigned i = 0; i < c->cap && !p; i++) {
+		if(c->e[i] && c->e[i]->hash == hash) {p = c->e[i]; p->ref++; p->used = ++c->tick;}
+	}
+	pthread_mutex_unlock(&c->mu);
+	return p;
+}
+
+vmdprog_t *idlevmd_put(vmdcache_t *c, vmdprog_t *n) {
+	/*
+		* caches N or returns the entry already holding the same bytes, N
+		* stays uncached when its hash collides with other bytes or every
+		* entry is running
+	*/
+	vmdprog_t *p = NULL; unsigned k = c->cap;
+	pthread_mutex_lock(&c->mu);
+	for(unsigned i = 0; i < c->cap; i++) {
+		vmdprog_t *e = c->e[i];
+		if(e && e->hash == n->hash) {
+			if(e->nbyte == n->nbyte && !memcmp(e->code, n->code, n->nbyte)) {p = e; p->ref++; p->used = ++c->tick;}
+			k = c->cap;
+			break;
+		}
+		if(!e) {k = i;}
+		else if(!e->ref && (k == c->cap || (c->e[k] && e->used < c->e[k]->used))) {k = i;}
+	}
+	if(!p) {
+		p = n;
+		n = NULL;
+		p->ref = 1;
+		p->used = ++c->tick;
+		if(k < c->cap) {
+			if(c->e[k]) {c->e[k]->live = 0; idlevmd_free(c->e[k]);}
+			c->e[k] = p;
+			p->live = 1;
+		}
+	}
+	pthread_mutex_unlock(&c->mu);
+	if(n) {idlevmd_free(n);}
+	return p;
+}
+
+void idlevmd_release(vmdcache_t *c, vmdprog_t *p) {
+	int f;
+	pthread_mutex_lock(&c->mu);
+	f = !--p->ref && !p->live;
+	pthread_mutex_unlock(&c->mu);
+	if(f) {idlevmd_free(p);}
+}
+
+int idlevmd_read(int fd, void *p, uint64_t n) {
+	/* 0 once all N bytes are in, -1 on error or end of stream */
+	for(uint64_t k = 0; k < n;) {
+		ssize_t r = read(fd, (char *)p + k, n - k);
+		if(r < 0 && errno == EINTR) {continue;}
+		if(r <= 0) {return -1;}
+		k += (uint64_t)r;
+	}
+	return 0;
+}
+
+int idlevmd_write(int fd, const void *p, uint64_t n) {
+	for(uint64_t k = 0; k < n;) {
+		ssize_t r = send(fd, (const char *)p + k, n - k, MSG_NOSIGNAL);
+		if(r < 0 && errno == EINTR) {continue;}
+		if(r <= 0) {return -1;}
+		k += (uint64_t)r;
+	}
+	return 0;
+}
+
+int idlevmd_run(vmdworker_t *w, vmdprog_t *p, char *in, uint64_t nin, idlevmd_rsp *r, char **out, char **err) {
+	/*
+		* runs P with stdin IN on the worker's VM and collects its output,
+		* a runtime error, int exit or a guest fault comes back through
+		* the jump buffers, then the VM is reset for the next request
+	*/
+	idle_vm *v = &w->v; jmp_buf jb; sigjmp_buf fj;
+	size_t no = 0, ne = 0; volatile int st = 0;
+	v->in = fmemopen(in, nin, "r");
+	if(!v->in) {v->in = fopen("/dev/null", "r");}
+	v->out = open_memstream(out, &no);
+	v->err = open_memstream(err, &ne);
+	if(!v->in || !v->out || !v->err) {idlevmd_error(IDLEVMD_ERR_ALLOCATION_FAILED, "memory allocation failed");}
+	v->jmp = &jb;
+	if(sigsetjmp(fj, 1)) {
+		idlevmd_fjb = NULL;
+		fprintf(v->err, "[idle_err] %#.8x, %s\n", IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS, "IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS");
+		st = IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS;
+	} else if(setjmp(jb)) {
+		idlevmd_fjb = NULL;
+		st = v->status;
+	} else {
+		size_t n = p->nbyte / sizeof(idlevm_command);
+		idlevmd_fjb = &fj;
+		if(!n) {idlevm_logerr(v, IDLEVM_ERR_FILE_NOT_READ, "IDLEVM_ERR_FILE_NOT_READ");}
+		n = idlevm_link(v, (idlevm_command *)p->code, n);
+		idlevm_run(v, (idlevm_command *)p->code, n);
+		idlevmd_fjb = NULL;
+		st = 0;
+	}
+	v->jmp = NULL;
+	fclose(v->in);
+	fclose(v->out);
+	fclose(v->err);
+	v->in = stdin; v->out = stdout; v->err = stderr;
+	idlevm_reset(v);
+	r->status = st;
+	r->nout = no;
+	r->nerr = ne;
+	return st;
+}
+
+int idlevmd_serve(vmdworker_t *w, int fd) {
+	/* requests of one connection until the client closes it or sends garbage */
+	idlevmd_req q; idlevmd_rsp r;
+	while(!idlevmd_read(fd, &q, sizeof(q))) {
+		vmdprog_t *p = NULL; char *in, *out = NULL, *err = NULL; int ok;
+		memset(&r, 0, sizeof(r));
+		memcpy(r.magic, IDLEVMD_RMAGIC, 4);
+		if(memcmp(q.magic, IDLEVMD_MAGIC, 4) || q.version != IDLEVMD_VERSION || q.nprog > IDLEVMD_MAXPROG || q.nin > IDLEVMD_MAXIN) {
+			r.flags = IDLEVMD_BAD;
+			idlevmd_write(fd, &r, sizeof(r));
+			return -1;
+		}
+		if(q.nprog) {
+			p = idlevmd_alloc(sizeof(vmdprog_t));
+			p->code = idlevmd_alloc((q.nprog + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t));
+			p->nbyte = q.nprog;
+			if(idlevmd_read(fd, p->code, q.nprog)) {idlevmd_free(p); return -1;}
+			p->hash = idlevmd_hash(p->code, p->nbyte);
+			p = idlevmd_put(w->c, p);
+		} else {
+			p = idlevmd_get(w->c, q.hash);
+		}
+		in = idlevmd_alloc(q.nin);
+		if(idlevmd_read(fd, in, q.nin)) {free(in); if(p) {idlevmd_release(w->c, p);} return -1;}
+		r.hash = p ? p->hash : q.hash;
+		if(!p) {
+			r.flags = IDLEVMD_MISS;
+			ok = !idlevmd_write(fd, &r, sizeof(r));
+		} else {
+			idlevmd_run(w, p, in, q.nin, &r, &out, &err);
+			idlevmd_release(w->c, p);
+			ok = !idlevmd_write(fd, &r, sizeof(r)) && !idlevmd_write(fd, out, r.nout) && !idlevmd_write(fd, err, r.nerr);
+		}
+		free(in); free(out); free(err);
+		if(!ok) {return -1;}
+	}
+	return 0;
+}
+
+void *idlevmd_worker(void *a) {
+	vmdworker_t *w = (vmdworker_t *)a;
+	idlevmd_fvm = &w->v;
+	for(;;) {
+		int fd = accept(w->ls, NULL, NULL);
+		if(fd < 0) {
+			if(errno == EINTR || errno == ECONNABORTED) {continue;}
+			idlevmd_error(IDLEVMD_ERR_SOCKET_FAILED, "accept failed");
+		}
+		idlevmd_serve(w, fd);
+		close(fd);
+	}
+	return NULL;
+}
+
+int idlevmd_main(int argc, char **argv) {
+	const char *path = NULL; int nw = 4, ncache = 256;
+	struct sockaddr_un sa; struct sigaction sg; vmdcache_t c;
+	for(int a = 1; a < argc; a++) {
+		if(a + 1 < argc && !strcmp(argv[a], "-j")) {nw = atoi(argv[++a]);}
+		else if(a + 1 < argc && !strcmp(argv[a], "-c")) {ncache = atoi(argv[++a]);}
+		else if(argv[a][0] != '-' && !path) {path = argv[a];}
+		else {path = NULL; break;}
+	}
+	if(!path || nw < 1 || ncache < 1) {
+		fprintf(stderr, "usage: vmd socket [-j workers] [-c programs]\n");
+		return IDLEVMD_ERR_FAILED_EXIT;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	if(strlen(path) >= sizeof(sa.sun_path)) {idlevmd_error(IDLEVMD_ERR_SOCKET_FAILED, "socket path is too long");}
+	strcpy(sa.sun_path, path);
+	int ls = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(ls < 0) {idlevmd_error(IDLEVMD_ERR_SOCKET_FAILED, "socket failed");}
+	unlink(path);
+	if(bind(ls, (struct sockaddr *)&sa, sizeof(sa)) || listen(ls, 64)) {idlevmd_error(IDLEVMD_ERR_SOCKET_FAILED, "bind failed");}
+
+	memset(&sg, 0, sizeof(sg));
+	sg.sa_sigaction = idlevmd_fault;
+	sg.sa_flags = SA_SIGINFO;
+	sigaction(SIGSEGV, &sg, NULL);
+	sigaction(SIGBUS, &sg, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	pthread_mutex_init(&c.mu, NULL);
+	c.cap = (unsigned)ncache;
+	c.e = idlevmd_alloc(c.cap * sizeof(vmdprog_t *));
+	c.tick = 0;
+	vmdworker_t *w = idlevmd_alloc((size_t)nw * sizeof(vmdworker_t));
+	for(int i = 0; i < nw; i++) {
+		w[i].ls = ls;
+		w[i].c = &c;
+		idlevm_init(&w[i].v);
+		if(pthread_create(&w[i].th, NULL, idlevmd_worker, &w[i])) {idlevmd_error(IDLEVMD_ERR_ALLOCATION_FAILED, "thread creation failed");}
+	}
+	for(int i = 0; i < nw; i++) {pthread_join(w[i].th, NULL);}
+	return 0;
+}
+#else
+int idlevmd_main(int argc, char **argv) {
+	fprintf(stderr, "vmd: needs Unix domain sockets\n");
+	return IDLEVMD_ERR_FAILED_EXIT;
+}
+#endif
+
+int main(int argc, char **argv) {
+	return idlevmd_main(argc, argv);
+}
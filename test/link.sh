@@ -0,0 +1,68 @@
+#!/bin/sh
+# objects, ld and the rebuild cache
+#
+# test/link/main.idsm calls square in math.idsm and shown and finish in
+# io.idsm, math.idsm also exports cube, which nothing calls
+#
+# ASM, LD and VM override build/asm.exe, build/ld.exe and build/vm.exe
+
+A=${ASM:-build/asm.exe}
+L=${LD:-build/ld.exe}
+V=${VM:-build/vm.exe}
+T=$(mktemp -d) || exit 1
+trap 'rm -rf "$T"' EXIT
+n=0; bad=0
+
+check() {
+	# check NAME CONDITION...
+	n=$((n + 1))
+	name=$1; shift
+	if ! "$@"; then echo "FAIL $name"; bad=$((bad + 1)); fi
+}
+
+same() { [ "$1" = "$2" ]; }
+fails() { ! "$@" > /dev/null 2>&1; }
+marked() { tail -c 4 "$1" | grep -q MARK; }
+
+for f in main math io; do cp test/link/$f.idsm "$T/$f.idsm"; done
+for f in main math io; do "$A" "$T/$f.idsm" "$T/$f.o" -c || bad=$((bad + 1)); done
+
+# cross-object calls and jumps resolve, and cube is stripped
+"$L" "$T/p.bin" "$T/main.o" "$T/math.o" "$T/io.o"
+check "linked output" same "$("$V" "$T/p.bin")" "1 4 9 16 25 "
+"$L" "$T/all.bin" "$T/main.o" "$T/math.o" "$T/io.o" --no-strip
+check "no-strip output" same "$("$V" "$T/all.bin")" "1 4 9 16 25 "
+check "unused function stripped" [ $(wc -c < "$T/p.bin") -lt $(wc -c < "$T/all.bin") ]
+
+# one object linked alone is the monolithic binary
+cat "$T/main.idsm" "$T/math.idsm" "$T/io.idsm" > "$T/one.idsm"
+"$A" "$T/one.idsm" "$T/one.o" -c
+"$L" "$T/one.bin" "$T/one.o" --no-strip
+"$A" "$T/one.idsm" "$T/mono.bin"
+check "single object is monolithic" cmp -s "$T/one.bin" "$T/mono.bin"
+
+# imports that nobody defines, or that two objects define, are errors
+check "undefined symbol" fails "$L" "$T/x.bin" "$T/main.o" "$T/math.o"
+check "duplicate symbol" fails "$L" "$T/x.bin" "$T/main.o" "$T/math.o" "$T/io.o" "$T/io.o"
+
+# a hit leaves the object alone, so a marker appended to it survives;
+# an edit, other options or another object version rebuild it
+printf MARK >> "$T/math.o"
+"$A" "$T/math.idsm" "$T/math.o" -c
+check "cache hit on unchanged source" marked "$T/math.o"
+"$A" "$T/math.idsm" "$T/math.o" -c -g "$T/math.map"
+check "cache miss on other options" fails marked "$T/math.o"
+check "map written on a miss" [ -s "$T/math.map" ]
+printf MARK >> "$T/math.o"
+printf '    nop;\n' >> "$T/math.idsm"
+"$A" "$T/math.idsm" "$T/math.o" -c -g "$T/math.map"
+check "cache miss on edited source" fails marked "$T/math.o"
+printf MARK >> "$T/math.o"
+printf '\377' | dd of="$T/math.o" bs=1 seek=4 conv=notrunc 2> /dev/null
+"$A" "$T/math.idsm" "$T/math.o" -c -g "$T/math.map"
+check "cache miss on other version" fails marked "$T/math.o"
+"$L" "$T/p.bin" "$T/main.o" "$T/math.o" "$T/io.o"
+check "relinked output" same "$("$V" "$T/p.bin")" "1 4 9 16 25 "
+
+echo "link: $n checks, $bad failed"
+[ $bad -eq 0 ]
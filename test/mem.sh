@@ -0,0 +1,120 @@
+#!/bin/sh
+# guest memory: loads, stores and the interrupts that take a guest address
+# stop with IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS outside the raw data and the
+# mapped regions, push and pop stop at the ends of the stack, in vm.exe and
+# in the C aot.exe writes; through vmd.exe such a fault ends only its
+# request
+#
+# ASM, VM, AOT, VMD and VMC override build/asm.exe, build/vm.exe,
+# build/aot.exe, build/vmd.exe and build/vmc.exe, CC the compiler of the
+# translated programs
+
+A=${ASM:-build/asm.exe}
+V=${VM:-build/vm.exe}
+O=${AOT:-build/aot.exe}
+D=${VMD:-build/vmd.exe}
+Q=${VMC:-build/vmc.exe}
+C=${CC:-gcc}
+T=$(mktemp -d) || exit 1
+trap 'kill $pid 2> /dev/null; rm -rf "$T"' EXIT
+pid=
+n=0; bad=0
+E="[idle_err] 0x00000003, IDLEVM_ERR_ILLEGAL_MEMORY_ACCESS"
+
+$C -std=c99 -O2 -DIDLEVM_EMBED -c -o "$T/vm.o" src/vm.c || exit 1
+
+case_() {
+	# case_ NAME EXPECTED PROGRAM, EXPECTED is the status and the output
+	n=$((n + 1))
+	printf '%s' "$3" > "$T/p.idsm"
+	if ! "$A" "$T/p.idsm" "$T/p.bin" > "$T/out" 2>&1; then echo "FAIL $1 (asm)"; bad=$((bad + 1)); return; fi
+	got=$("$V" "$T/p.bin" < /dev/null 2>&1; echo " rc=$?")
+	if [ "$got" != "$2" ]; then echo "FAIL $1: $got"; bad=$((bad + 1)); fi
+	"$O" "$T/p.bin" "$T/p.c" && $C -std=c99 -O2 -Isrc -o "$T/p.exe" "$T/p.c" "$T/vm.o" || { echo "FAIL $1 (aot)"; bad=$((bad + 1)); return; }
+	got=$("$T/p.exe" < /dev/null 2>&1; echo " rc=$?")
+	if [ "$got" != "$2" ]; then echo "FAIL $1 aot: $got"; bad=$((bad + 1)); fi
+}
+
+case_ "last raw element" "7 rc=0" '    mov t2, 16383;
+    mov t0, 7;
+    stqb t0, t2;
+    ldqb t1, t2;
+    mov rg0, t1;
+    int writen;
+    hlt;
+'
+case_ "ldb past the range" "$E
+ rc=3" '    mov t2, 0x0000010000000000;
+    ldb t0, t2;
+    hlt;
+'
+case_ "ldqb past the range" "$E
+ rc=3" '    mov t2, 0x0000004000000000;
+    ldqb t0, t2;
+    hlt;
+'
+case_ "stdb wrapped negative" "$E
+ rc=3" '    mov t2, 0;
+    sub t2, 1;
+    stdb t0, t2;
+    hlt;
+'
+case_ "stb in a hole" "$E
+ rc=3" '    mov t2, 0x20000;
+    stb t0, t2;
+    hlt;
+'
+case_ "writes past the range" "$E
+ rc=3" '    mov rg0, 0x0000020000000000;
+    int writes;
+    hlt;
+'
+case_ "writes unterminated" "$E
+ rc=3" '    mov t2, 65535;
+    mov t0, 65;
+    stb t0, t2;
+    mov rg0, t2;
+    int writes;
+    hlt;
+'
+case_ "reads past raw data" "$E
+ rc=3" '    mov rg0, 65530;
+    mov rg1, 100;
+    int reads;
+    hlt;
+'
+case_ "loadsd past the stack" "$E
+ rc=3" '    mov rg0, 0x100000;
+    int loadsd;
+    hlt;
+'
+case_ "push past the stack" "[idle_err] 0x00000008, IDLEVM_ERR_STACK_OVERFLOW
+ rc=8" '    mov t1, 0x7000;
+L0:
+    push t0;
+    loop t1, L0;
+    hlt;
+'
+case_ "pop an empty stack" "[idle_err] 0x00000009, IDLEVM_ERR_STACK_UNDERFLOW
+ rc=9" '    pop t0;
+    hlt;
+'
+
+# the server answers a guest fault with its status and goes on serving
+"$D" "$T/s" -j 1 & pid=$!
+i=0; while [ ! -S "$T/s" ] && [ $i -lt 50 ]; do sleep 0.1; i=$((i + 1)); done
+printf '    mov t2, 0x20000;\n    ldb t0, t2;\n    hlt;\n' > "$T/p.idsm"
+"$A" "$T/p.idsm" "$T/hole.bin"
+printf '    mov rg0, 0x0000020000000000;\n    int writes;\n    hlt;\n' > "$T/p.idsm"
+"$A" "$T/p.idsm" "$T/writes.bin"
+"$A" example/hello_world.idsm "$T/hello.bin"
+for b in hole writes hole hello; do
+	n=$((n + 1))
+	got=$("$Q" "$T/s" "$T/$b.bin" < /dev/null 2>&1; echo " rc=$?")
+	if [ $b = hello ]; then want="Hello world! rc=0"; else want="$E
+ rc=3"; fi
+	if [ "$got" != "$want" ]; then echo "FAIL vmd $b: $got"; bad=$((bad + 1)); fi
+done
+
+echo "mem: $n programs, $bad failed"
+[ $bad -eq 0 ]
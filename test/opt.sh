@@ -0,0 +1,83 @@
+#!/bin/sh
+# plain, -O and -O2 builds: every program must print the same and exit
+# with the same status however it was assembled
+#
+# test/opt/*.idsm   arith: mul/imul/div/mod by powers of two and other
+#                   constants; flow: label-only lines in loops, jump
+#                   chains, redundant moves, cmp + j<cc>, call + ret;
+#                   dataflow: constants and copies across blocks, dead
+#                   stores, cmov, unreachable code; trap_*: a dead load,
+#                   lds or division that stops the program
+# example/*.idsm    the examples that need no host
+# generated         loops shaped like the vmbench programs, with ALU
+#                   work, wide literals, division by constants and
+#                   forward branches, that print every register at the end
+#
+# ASM and VM override build/asm.exe and build/vm.exe, GEN the number of
+# generated programs
+
+A=${ASM:-build/asm.exe}
+V=${VM:-build/vm.exe}
+G=${GEN:-40}
+MODES="-O -O2"
+T=$(mktemp -d) || exit 1
+trap 'rm -rf "$T"' EXIT
+
+gen() {
+	awk -v seed="$1" 'BEGIN {
+		srand(seed)
+		nr = split("t0 t1 t2 t3 t4 t5 t6 t7 s0 s1 s2 s3", R, " ")
+		nrr = split("add sub xor and or mul imul min max", RR, " ")
+		nri = split("add sub xor and or mul rsb", RI, " ")
+		ndv = split("2 4 8 64 1024 3 7 10 1000 12345", DV, " ")
+		nj = split("jl jg je jne jle jge", J, " ")
+		for(i = 1; i <= nr; i++) {printf "    mov %s, %d;\n", R[i], int(rand() * 100000)}
+		printf "    mov s11, %d;\nL0:\n", 20 + int(rand() * 30)
+		f = 0; wait = -1
+		for(i = 0; i < 60; i++) {
+			a = R[1 + int(rand() * nr)]; b = R[1 + int(rand() * nr)]; r = rand() * 100
+			if(r < 30) {printf "    %s %s, %s;\n", RR[1 + int(rand() * nrr)], a, b}
+			else if(r < 50) {printf "    %s %s, %d;\n", RI[1 + int(rand() * nri)], a, int(rand() * 64)}
+			else if(r < 62) {printf "    %s %s, %s;\n", (rand() < 0.5 ? "div" : (rand() < 0.5 ? "mod" : "mul")), a, DV[1 + int(rand() * ndv)]}
+			else if(r < 68) {printf "    shr %s, %d;\n", a, 1 + int(rand() * 8)}
+			else if(r < 74) {printf "    mov %s, 0x%04X%04X%04X%04X;\n", a, int(rand() * 65536), int(rand() * 65536), int(rand() * 65536), int(rand() * 65536)}
+			else if(r < 80) {printf "    mov %s, %s;\n    mov %s, %s;\n", a, b, b, a}
+			else if(r < 90 && wait < 0) {printf "    cmp %s, %s;\n    %s F%d;\n", a, b, J[1 + int(rand() * nj)], f; wait = 1 + int(rand() * 4)}
+			else {printf "    xor %s, %s;\n", a, b}
+			if(wait == 0) {
+				if(rand() < 0.3) {printf "F%d:\n    jmp C%d;\nC%d:\n", f, f, f} else {printf "F%d:\n", f}
+				f++
+			}
+			if(wait >= 0) {wait--}
+		}
+		if(wait >= 0) {printf "F%d:\n", f}
+		print "    loop s11, L0;"
+		for(i = 1; i <= nr; i++) {printf "    mov rg0, %s;\n    int writen;\n    mov rg0, 10;\n    int writec;\n", R[i]}
+		print "    hlt;"
+	}' > "$T/gen$1.idsm"
+}
+
+run() {
+	# the assembler's status, or the program's output and status
+	"$A" "$1" "$T/p.bin" $2 > "$T/out" 2>&1 || { echo "asm rc=$?"; cat "$T/out"; return; }
+	"$V" "$T/p.bin" < /dev/null > "$T/out" 2>&1
+	echo "rc=$?"
+	cat "$T/out"
+}
+
+i=1
+while [ $i -le "$G" ]; do gen $i; i=$((i + 1)); done
+n=0; bad=0
+for s in test/opt/*.idsm example/hello_world.idsm "$T"/gen*.idsm; do
+	ref=$(run "$s" "")
+	for o in $MODES; do
+		got=$(run "$s" "$o")
+		if [ "$got" != "$ref" ]; then
+			echo "FAIL $s $o"
+			bad=$((bad + 1))
+		fi
+	done
+	n=$((n + 1))
+done
+echo "opt: $n programs, $bad failed"
+[ $bad -eq 0 ]